@@ -0,0 +1,172 @@
+// allocationbench.cpp : Counts heap allocations made by Simulation::step once
+// a scene of colliding particles has settled into a steady state, while one
+// particle a step is destroyed and replaced. Any allocation after warm-up is
+// a failure; the contact buffer, frame arena and particle pool's free list
+// should have grown to fit during warm-up.
+//
+
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <groundcontact.hpp>
+#include <simulation.hpp>
+#include <sweepprunecontact.hpp>
+#include <uniformgridcontact.hpp>
+
+#include "benchutil.hpp"
+
+static std::atomic<unsigned long> allocationCount(0);
+
+void* operator new(size_t size)
+{
+    allocationCount++;
+    void* memory = malloc(size ? size : 1);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+static const float TIME_STEP = 1.0f / 60.0f;
+static const unsigned WARMUP_STEPS = 600;
+static const unsigned MEASURED_STEPS = 600;
+static const float RADIUS = 0.5f;
+
+// A block of particles settling onto the ground and each other, kept awake
+// so every step generates and resolves contacts
+static void buildScene(Simulation& simulation, unsigned count)
+{
+    unsigned state = 31u;
+    buildParticleBlock(simulation, count, 8, RADIUS, state);
+    for (unsigned i = 0; i < count; i++)
+    {
+        simulation.getParticles()[i]->setCanSleep(false);
+    }
+
+    RigidBody* body = simulation.getRigidBody(simulation.createRigidBody());
+    body->setPosition(0.0f, 10.0f, 0.0f);
+    body->setOrientation(0.0f, 0.0f, 0.0f, 1.0f);
+    body->setMass(1.0f);
+    body->setAcceleration(Vector3::GRAVITY);
+    body->setLinearDamping(0.99f);
+    body->setAngularDamping(0.99f);
+    body->setInertiaTensor(Matrix3x3(1, 0, 0, 0, 1, 0, 0, 0, 1));
+    body->setCanSleep(false);
+    body->clearAccumulators();
+    body->calculateDerivedData();
+}
+
+// Cleared when a replacement particle doesn't land in the slot just freed
+static bool slotsReused = true;
+
+// Destroys one particle and creates another in the same state, which the
+// pool should put in the slot just freed. Returns whether it did.
+static bool churn(Simulation& simulation, unsigned step)
+{
+    const std::vector<Particle*>& particles = simulation.getParticles();
+    Particle* destroyed = particles[step % particles.size()];
+    Particle state = *destroyed;
+
+    simulation.destroyParticle(destroyed);
+    Particle* created = simulation.createParticle();
+    *created = state;
+    return created == destroyed;
+}
+
+// Returns the allocations made during the measured steps
+static unsigned long run(const char* name, ParticleCollision& collision, ParticleContactResolver::Strategy strategy)
+{
+    // Start small so the contact buffer has to grow during warm-up
+    Simulation simulation(TIME_STEP, 4);
+    simulation.getResolver().setStrategy(strategy);
+    buildScene(simulation, 512);
+
+    GroundContact ground;
+    ground.init(simulation.getParticles());
+    collision.init(simulation.getParticles(), RADIUS);
+    simulation.addContactGenerator(&ground);
+    simulation.addContactGenerator(&collision);
+
+    for (unsigned step = 0; step < WARMUP_STEPS; step++)
+    {
+        simulation.getRigidBody(0)->addForce(Vector3::UP * (float)(step % 20));
+        simulation.step();
+        if (!churn(simulation, step)) slotsReused = false;
+    }
+
+    // Destroying a particle drops the step's contacts, so count them first
+    unsigned contacts = 0;
+    unsigned long before = allocationCount.load();
+    for (unsigned step = 0; step < MEASURED_STEPS; step++)
+    {
+        simulation.getRigidBody(0)->addForce(Vector3::UP * (float)(step % 20));
+        simulation.step();
+        contacts = simulation.getContactCount();
+        if (!churn(simulation, step)) slotsReused = false;
+    }
+    unsigned long allocations = allocationCount.load() - before;
+
+    printf("%s,%s,%u,%u,%u,%u,%zu,%u,%lu\n", name, strategy == ParticleContactResolver::LINEAR_SCAN ? "linear" : "priority",
+        MEASURED_STEPS, contacts, simulation.getContactHighWater(), simulation.getContactOverflowCount(),
+        simulation.getArena().getHighWater(), simulation.getArena().getOverflowCount(), allocations);
+
+    return allocations;
+}
+
+int main()
+{
+    unsigned long allocations = 0;
+
+    printf("broadphase,resolver,steps,contacts,contact_high_water,contact_overflows,arena_high_water_bytes,arena_overflows,allocations\n");
+
+    UniformGridContact grid;
+    allocations += run("uniform_grid", grid, ParticleContactResolver::LINEAR_SCAN);
+
+    UniformGridContact gridPriority;
+    allocations += run("uniform_grid", gridPriority, ParticleContactResolver::PRIORITY_QUEUE);
+
+    SweepPruneContact sweep;
+    allocations += run("sweep_prune", sweep, ParticleContactResolver::LINEAR_SCAN);
+
+    SweepPruneContact sweepPriority;
+    allocations += run("sweep_prune", sweepPriority, ParticleContactResolver::PRIORITY_QUEUE);
+
+    if (allocations > 0)
+    {
+        printf("Simulation::step allocated in steady state\n");
+        return 1;
+    }
+
+    if (!slotsReused)
+    {
+        printf("ObjectPool did not reuse a destroyed particle's slot\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#ifndef BENCHUTIL_HPP // include guard
+#define BENCHUTIL_HPP
+
+// Helpers shared by the benchmarks: a seeded random generator, so every run
+// and every bench builds the same scenes, the scene builders more than one
+// bench uses, and the comparisons and timings the world benches share.
+
+#include <chrono>
+#include <math.h>
+#include <time.h>
+#include <core.hpp>
+#include <rigidbody.hpp>
+#include <simulation.hpp>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+// Linear congruential generator; the state is the seed
+inline unsigned nextRandom(unsigned& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+inline float randomFloat(unsigned& state, float low, float high)
+{
+    return low + (nextRandom(state) & 0xFFFF) / 65535.0f * (high - low);
+}
+
+inline Quaternion randomQuaternion(unsigned& state)
+{
+    Quaternion q(randomFloat(state, -1.0f, 1.0f), randomFloat(state, -1.0f, 1.0f), randomFloat(state, -1.0f, 1.0f), randomFloat(state, -1.0f, 1.0f));
+    q.normalize();
+    return q;
+}
+
+// Largest difference relative to the magnitude of the expected value
+inline float relativeError(float expected, float actual)
+{
+    return fabsf(expected - actual) / (1.0f + fabsf(expected));
+}
+
+inline float relativeError(const Vector3& expected, const Vector3& actual)
+{
+    float error = relativeError(expected.x, actual.x);
+    error = fmaxf(error, relativeError(expected.y, actual.y));
+    return fmaxf(error, relativeError(expected.z, actual.z));
+}
+
+// Largest relative error between an object and its copy in a world, over
+// position and velocity
+template <class Object, class World>
+inline float worldError(const Object& expected, const World& world, unsigned handle)
+{
+    float error = relativeError(expected.getPosition(), world.getPosition(handle));
+    return fmaxf(error, relativeError(expected.getVelocity(), world.getVelocity(handle)));
+}
+
+inline double elapsedMs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// CPU time the calling thread has used; unlike elapsedMs it leaves out the
+// time other threads ran in between
+inline double threadCpuMs()
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+    unsigned long long ticks = ((unsigned long long)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime) +
+        ((unsigned long long)user.dwHighDateTime << 32 | user.dwLowDateTime);
+    return ticks / 10000.0;
+#else
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+#endif
+}
+
+// A body somewhere in a box extent wide and high above the ground, tumbling
+// under gravity with a non-diagonal inertia tensor so torque takes the full
+// tensor path
+inline void initRandomBody(RigidBody& body, unsigned& state, float extent)
+{
+    float half = extent * 0.5f;
+    body.setPosition(randomFloat(state, -half, half), randomFloat(state, 0.0f, half), randomFloat(state, -half, half));
+    body.setOrientation(randomFloat(state, -1.0f, 1.0f), randomFloat(state, -1.0f, 1.0f), randomFloat(state, -1.0f, 1.0f), randomFloat(state, -1.0f, 1.0f));
+    body.setVelocity(randomFloat(state, -5.0f, 5.0f), randomFloat(state, -5.0f, 5.0f), randomFloat(state, -5.0f, 5.0f));
+    body.setAcceleration(Vector3::GRAVITY);
+    body.setMass(randomFloat(state, 0.5f, 5.0f));
+    body.setLinearDamping(randomFloat(state, 0.9f, 1.0f));
+    body.setAngularDamping(randomFloat(state, 0.9f, 1.0f));
+
+    float a = randomFloat(state, 0.5f, 2.0f);
+    float b = randomFloat(state, 0.5f, 2.0f);
+    float c = randomFloat(state, 0.5f, 2.0f);
+    body.setInertiaTensor(Matrix3x3(a, 0.1f, 0, 0.1f, b, 0, 0, 0, c));
+
+    body.clearAccumulators();
+    body.calculateDerivedData();
+}
+
+// Particles of the given radius packed side by side in layers of side x side,
+// spaced just under a diameter apart so they start touching their neighbours
+// and the bottom layer touches the ground
+inline void buildParticleBlock(Simulation& simulation, unsigned count, unsigned side, float radius, unsigned& state)
+{
+    float spacing = radius * 1.8f;
+    for (unsigned i = 0; i < count; i++)
+    {
+        Particle* p = simulation.createParticle();
+        p->setPosition((i % side) * spacing, radius + (i / (side * side)) * spacing, ((i / side) % side) * spacing);
+        p->setVelocity(0.0f, randomFloat(state, -1.0f, 0.0f), 0.0f);
+        p->setAcceleration(Vector3::GRAVITY);
+        p->setDamping(0.99f);
+        p->setMass(randomFloat(state, 0.5f, 2.0f));
+    }
+}
+
+#endif
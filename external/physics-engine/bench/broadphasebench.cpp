@@ -0,0 +1,226 @@
+// broadphasebench.cpp : Compares the uniform grid and sweep-and-prune
+// particle collision generators against brute force all-pairs testing. All
+// three must report exactly the same set of overlapping particle pairs,
+// including pairs far outside the range of the grid's cell indices.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <utility>
+#include <vector>
+
+#include <particle.hpp>
+#include <particlecollision.hpp>
+#include <pcontact.hpp>
+#include <sweepprunecontact.hpp>
+#include <uniformgridcontact.hpp>
+
+#include "benchutil.hpp"
+
+static const float RADIUS = 0.5f;
+static const unsigned FRAMES = 5;
+
+// Tests every pair; the reference the broadphases have to agree with
+class BruteForceContact : public ParticleCollision
+{
+public:
+    virtual unsigned addContactChecked(ParticleContact* contact, unsigned limit, bool* truncated) const
+    {
+        unsigned count = 0;
+        *truncated = false;
+
+        ParticleContact spare;
+        const std::vector<Particle*>& list = *particles;
+        for (unsigned i = 0; i < list.size(); i++)
+        {
+            for (unsigned j = i + 1; j < list.size(); j++)
+            {
+                if (addPairContact(count < limit ? contact : &spare, list[i], list[j]))
+                {
+                    if (count == limit)
+                    {
+                        *truncated = true;
+                        return count;
+                    }
+
+                    contact++;
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+};
+
+// Implements only the two-argument addContact, like generators written
+// before truncation was reported
+class TwoArgumentContact : public ParticleContactGenerator
+{
+public:
+    explicit TwoArgumentContact(const ParticleContactGenerator& inner) : inner(inner) {}
+
+    virtual unsigned addContact(ParticleContact* contact, unsigned limit) const
+    {
+        return inner.addContact(contact, limit);
+    }
+
+private:
+    const ParticleContactGenerator& inner;
+};
+
+static double timeGenerator(const ParticleContactGenerator& generator, std::vector<ParticleContact>& contacts, unsigned* used, bool* truncated)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    *used = generator.addContactChecked(&contacts[0], (unsigned)contacts.size(), truncated);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+typedef std::vector<std::pair<unsigned, unsigned> > PairSet;
+
+// The overlapping pairs as sorted (lower, higher) particle indices
+static void collectPairs(const std::vector<ParticleContact>& contacts, unsigned used, const Particle* base, PairSet& pairs)
+{
+    pairs.resize(used);
+    for (unsigned i = 0; i < used; i++)
+    {
+        unsigned a = (unsigned)(contacts[i].particle[0] - base);
+        unsigned b = (unsigned)(contacts[i].particle[1] - base);
+        pairs[i] = std::make_pair(std::min(a, b), std::max(a, b));
+    }
+    std::sort(pairs.begin(), pairs.end());
+}
+
+int main()
+{
+    const unsigned particleCounts[] = { 1000, 10000, 100000 };
+    bool matched = true;
+
+    printf("particles,generator,ms_per_frame,contacts\n");
+
+    for (unsigned n = 0; n < sizeof(particleCounts) / sizeof(particleCounts[0]); n++)
+    {
+        unsigned numParticles = particleCounts[n];
+
+        // About eight diameters cubed of space per particle
+        float extent = cbrtf(8.0f * numParticles);
+        unsigned state = 12345u;
+
+        std::vector<Particle> storage(numParticles);
+        std::vector<Particle*> particles(numParticles);
+        for (unsigned i = 0; i < numParticles; i++)
+        {
+            storage[i].setPosition(randomFloat(state, 0.0f, extent), randomFloat(state, 0.0f, extent), randomFloat(state, 0.0f, extent));
+            particles[i] = &storage[i];
+        }
+
+        // Stragglers beyond the range of an int cell index: one overlapping
+        // pair and two loners
+        storage[0].setPosition(5e9f, 0.0f, 0.0f);
+        storage[1].setPosition(5e9f, 0.5f, 0.0f);
+        storage[2].setPosition(-1e20f, 0.0f, 0.0f);
+        storage[3].setPosition(0.0f, 0.0f, 3e38f);
+
+        // The last particle touches another, so taking it off the list shows
+        storage[numParticles - 1].setPosition(storage[4].getPosition() + Vector3(0.5f, 0.0f, 0.0f));
+
+        std::vector<ParticleContact> contacts(numParticles * 8);
+
+        BruteForceContact brute;
+        UniformGridContact grid;
+        SweepPruneContact sweep;
+        brute.init(particles, RADIUS);
+        grid.init(particles, RADIUS);
+        sweep.init(particles, RADIUS);
+
+        PairSet brutePairs;
+        PairSet gridPairs;
+        PairSet sweepPairs;
+
+        unsigned bruteUsed;
+        bool truncated;
+        double bruteMs = timeGenerator(brute, contacts, &bruteUsed, &truncated);
+        collectPairs(contacts, bruteUsed, &storage[0], brutePairs);
+        if (truncated) matched = false;
+
+        double gridMs = 0.0;
+        double sweepMs = 0.0;
+        unsigned gridUsed = 0;
+        unsigned sweepUsed = 0;
+
+        for (unsigned frame = 0; frame < FRAMES; frame++)
+        {
+            if (frame > 0)
+            {
+                // Jitter particles so sweep-and-prune has to repair its order
+                for (unsigned i = 0; i < numParticles; i++)
+                {
+                    Vector3 position = storage[i].getPosition();
+                    position.x += randomFloat(state, -0.05f, 0.05f);
+                    storage[i].setPosition(position);
+                }
+            }
+
+            gridMs += timeGenerator(grid, contacts, &gridUsed, &truncated);
+            collectPairs(contacts, gridUsed, &storage[0], gridPairs);
+            if (truncated) matched = false;
+
+            sweepMs += timeGenerator(sweep, contacts, &sweepUsed, &truncated);
+            collectPairs(contacts, sweepUsed, &storage[0], sweepPairs);
+            if (truncated) matched = false;
+
+            // Brute force is too slow to rerun, so later frames compare the broadphases with each other
+            if (gridPairs != sweepPairs) matched = false;
+            if (frame == 0 && gridPairs != brutePairs) matched = false;
+        }
+
+        // A buffer exactly the size of the result is not truncated; one contact short is
+        const ParticleContactGenerator* generators[2] = { &grid, &sweep };
+        for (unsigned g = 0; g < 2 && gridUsed > 0; g++)
+        {
+            if (generators[g]->addContactChecked(&contacts[0], gridUsed, &truncated) != gridUsed || truncated) matched = false;
+            if (generators[g]->addContactChecked(&contacts[0], gridUsed - 1, &truncated) != gridUsed - 1 || !truncated) matched = false;
+            if (generators[g]->addContact(&contacts[0], gridUsed - 1) != gridUsed - 1) matched = false;
+        }
+
+        // Without its own check, a generator that fills the buffer may have been truncated
+        TwoArgumentContact twoArgument(grid);
+        if (twoArgument.addContactChecked(&contacts[0], gridUsed, &truncated) != gridUsed || !truncated) matched = false;
+        if (twoArgument.addContactChecked(&contacts[0], gridUsed + 1, &truncated) != gridUsed || truncated) matched = false;
+
+        // The generators read the list they were given, so a particle taken
+        // off it after init() drops out of the contacts and comes back with it
+        PairSet withoutLast;
+        for (unsigned i = 0; i < gridPairs.size(); i++)
+        {
+            if (gridPairs[i].second != numParticles - 1) withoutLast.push_back(gridPairs[i]);
+        }
+        for (unsigned pass = 0; pass < 2; pass++)
+        {
+            if (pass == 0) particles.pop_back();
+            else particles.push_back(&storage[numParticles - 1]);
+
+            for (unsigned g = 0; g < 2; g++)
+            {
+                PairSet pairs;
+                unsigned used = generators[g]->addContactChecked(&contacts[0], (unsigned)contacts.size(), &truncated);
+                collectPairs(contacts, used, &storage[0], pairs);
+                if (truncated || pairs != (pass == 0 ? withoutLast : gridPairs) || withoutLast == gridPairs) matched = false;
+            }
+        }
+
+        printf("%u,brute_force,%.3f,%u\n", numParticles, bruteMs, bruteUsed);
+        printf("%u,uniform_grid,%.3f,%u\n", numParticles, gridMs / FRAMES, gridUsed);
+        printf("%u,sweep_prune,%.3f,%u\n", numParticles, sweepMs / FRAMES, sweepUsed);
+    }
+
+    if (!matched)
+    {
+        printf("broadphase contacts diverged from brute force\n");
+        return 1;
+    }
+
+    return 0;
+}
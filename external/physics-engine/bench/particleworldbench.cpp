@@ -0,0 +1,220 @@
+// particleworldbench.cpp : Checks ParticleWorld::integrate and integrateScalar
+// against Particle::integrate within float tolerance while particles are
+// removed and their handles reused, and while game code edits particles
+// through their views. Then compares integration throughput, and fails
+// unless the vector path is clearly faster than Particle::integrate at the
+// largest count.
+//
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#include <particle.hpp>
+#include <particleworld.hpp>
+
+#include "benchutil.hpp"
+
+static const unsigned STEPS = 100;
+static const float TIME_STEP = 1.0f / 60.0f;
+
+// Smallest speedup over Particle::integrate the vector path must reach at the
+// largest count, where memory traffic rather than arithmetic bounds both
+static const double MIN_SPEEDUP = 1.25;
+
+// Damping values shared between particles, so the world's damping classes
+// are created, shared and released as particles change
+static const float DAMPING_VALUES[] = { 0.9f, 0.95f, 0.99f, 1.0f };
+static const unsigned DAMPING_COUNT = sizeof(DAMPING_VALUES) / sizeof(DAMPING_VALUES[0]);
+
+static Particle randomParticle(unsigned& state)
+{
+    Particle particle;
+    particle.setPosition(randomFloat(state, -50.0f, 50.0f), randomFloat(state, 0.0f, 50.0f), randomFloat(state, -50.0f, 50.0f));
+    particle.setVelocity(randomFloat(state, -5.0f, 5.0f), randomFloat(state, -5.0f, 5.0f), randomFloat(state, -5.0f, 5.0f));
+    particle.setAcceleration(Vector3::GRAVITY);
+    particle.setDamping(DAMPING_VALUES[nextRandom(state) % DAMPING_COUNT]);
+
+    // A few particles with infinite mass, which must not move
+    if (nextRandom(state) % 16 == 0) particle.setInverseMass(0.0f);
+    else particle.setMass(randomFloat(state, 0.5f, 5.0f));
+
+    // The reference must integrate every step, like the world
+    particle.setCanSleep(false);
+    return particle;
+}
+
+int main()
+{
+    const unsigned particleCounts[] = { 103, 10003, 100003 };
+    const unsigned countCount = sizeof(particleCounts) / sizeof(particleCounts[0]);
+    const float tolerance = 1e-4f;
+    bool matched = true;
+    double speedup = 0.0;
+
+    printf("particles,steps,particle_ms,world_scalar_ms,world_simd_ms,speedup,max_relative_error\n");
+
+    for (unsigned n = 0; n < countCount; n++)
+    {
+        unsigned count = particleCounts[n];
+        unsigned state = 2024u;
+
+        // Both worlds see the same operations, so they hand out the same
+        // handles; the reference is indexed by handle
+        std::vector<Particle> reference;
+        std::vector<bool> live;
+        ParticleWorld simd;
+        ParticleWorld scalar;
+
+        for (unsigned i = 0; i < count; i++)
+        {
+            Particle particle = randomParticle(state);
+            ParticleHandle handle = simd.addParticle(particle);
+            if (scalar.addParticle(particle) != handle || handle != reference.size()) matched = false;
+            reference.push_back(particle);
+            live.push_back(true);
+        }
+
+        // Remove every fifth particle, then add replacements that reuse the
+        // freed handles while the dense arrays are reordered
+        for (ParticleHandle handle = 0; handle < count; handle += 5)
+        {
+            simd.removeParticle(handle);
+            scalar.removeParticle(handle);
+            live[handle] = false;
+        }
+        for (ParticleHandle handle = 0; handle < count; handle += 10)
+        {
+            Particle particle = randomParticle(state);
+            ParticleHandle reused = simd.addParticle(particle);
+            if (scalar.addParticle(particle) != reused || !(reused < count) || live[reused]) matched = false;
+            if (!matched) break;
+            reference[reused] = particle;
+            live[reused] = true;
+        }
+
+        // Contact generators hold a Particle pointer to every particle, so
+        // in a real scene every particle has a view
+        for (ParticleHandle handle = 0; handle < count; handle++)
+        {
+            if (!live[handle]) continue;
+            simd.getParticle(handle);
+            scalar.getParticle(handle);
+        }
+
+        double referenceMs = 0.0;
+        double scalarMs = 0.0;
+        double simdMs = 0.0;
+
+        for (unsigned step = 0; step < STEPS; step++)
+        {
+            // Every tenth step, edit every third particle through its view or
+            // through the world, changing damping so classes are shared and released
+            for (ParticleHandle handle = step % 3; step % 10 == 0 && handle < count; handle += 3)
+            {
+                if (!live[handle]) continue;
+
+                Particle& expected = reference[handle];
+                Vector3 velocity = expected.getVelocity() + Vector3(0.0f, 0.5f, 0.0f);
+                Vector3 acceleration = Vector3::GRAVITY + Vector3(0.1f * (step % 5), 0.0f, 0.0f);
+                float damping = DAMPING_VALUES[(handle + step) % DAMPING_COUNT];
+
+                expected.setVelocity(velocity);
+                expected.setAcceleration(acceleration);
+                expected.setDamping(damping);
+
+                if (handle % 2)
+                {
+                    Particle* views[2] = { simd.getParticle(handle), scalar.getParticle(handle) };
+                    for (unsigned v = 0; v < 2; v++)
+                    {
+                        views[v]->setVelocity(velocity);
+                        views[v]->setAcceleration(acceleration);
+                        views[v]->setDamping(damping);
+                    }
+                }
+                else
+                {
+                    ParticleWorld* worlds[2] = { &simd, &scalar };
+                    for (unsigned w = 0; w < 2; w++)
+                    {
+                        worlds[w]->setVelocity(handle, velocity);
+                        worlds[w]->setAcceleration(handle, acceleration);
+                        worlds[w]->setDamping(handle, damping);
+                    }
+                }
+            }
+
+            // Half way through, drop a handful more particles that have views
+            if (step == STEPS / 2)
+            {
+                for (ParticleHandle handle = 1; handle < count; handle += 12)
+                {
+                    if (!live[handle]) continue;
+                    simd.removeParticle(handle);
+                    scalar.removeParticle(handle);
+                    live[handle] = false;
+                }
+            }
+
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            for (unsigned i = 0; i < reference.size(); i++)
+            {
+                if (live[i]) reference[i].integrate(TIME_STEP);
+            }
+            std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+            scalar.integrateScalar(TIME_STEP);
+            std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+            simd.integrate(TIME_STEP);
+            std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+
+            referenceMs += elapsedMs(t0, t1);
+            scalarMs += elapsedMs(t1, t2);
+            simdMs += elapsedMs(t2, t3);
+        }
+
+        // Compare through the world accessors, and through the views where
+        // game code made them
+        float error = 0.0f;
+        unsigned liveCount = 0;
+        for (ParticleHandle handle = 0; handle < reference.size(); handle++)
+        {
+            if (live[handle] != simd.isValid(handle) || live[handle] != scalar.isValid(handle)) matched = false;
+            if (!live[handle]) continue;
+            liveCount++;
+
+            const Particle& expected = reference[handle];
+            const ParticleWorld* worlds[2] = { &simd, &scalar };
+            for (unsigned w = 0; w < 2; w++)
+            {
+                error = fmaxf(error, worldError(expected, *worlds[w], handle));
+                error = fmaxf(error, relativeError(expected.getAcceleration(), worlds[w]->getAcceleration(handle)));
+                if (worlds[w]->getDamping(handle) != expected.getDamping()) matched = false;
+                if (worlds[w]->getInverseMass(handle) != expected.getInverseMass()) matched = false;
+            }
+
+            error = fmaxf(error, relativeError(expected.getPosition(), simd.getParticle(handle)->getPosition()));
+            error = fmaxf(error, relativeError(expected.getVelocity(), scalar.getParticle(handle)->getVelocity()));
+        }
+        if (!(error <= tolerance) || liveCount != simd.getParticleCount() || liveCount != scalar.getParticleCount()) matched = false;
+
+        speedup = simdMs > 0.0 ? referenceMs / simdMs : 0.0;
+        printf("%u,%u,%.3f,%.3f,%.3f,%.1f,%g\n", count, STEPS, referenceMs, scalarMs, simdMs, speedup, error);
+    }
+
+    if (!matched)
+    {
+        printf("ParticleWorld diverged from Particle::integrate\n");
+        return 1;
+    }
+
+    if (speedup < MIN_SPEEDUP)
+    {
+        printf("ParticleWorld::integrate is only %.2fx faster than Particle::integrate at %u particles, below %.2fx\n",
+            speedup, particleCounts[countCount - 1], MIN_SPEEDUP);
+        return 1;
+    }
+
+    return 0;
+}
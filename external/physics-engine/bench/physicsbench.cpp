@@ -0,0 +1,515 @@
+// physicsbench.cpp : Regression benchmarks for the physics engine. Micro
+// benchmarks time the core.hpp math and the Particle and RigidBody
+// integrators; scene benchmarks step particles resting on GroundContact
+// through ParticleContactResolver, or ParticleContactParallelResolver when
+// given threads, for a fixed number of steps.
+//
+// Usage: physics-bench [--format csv|json] [--output path] [--filter text]
+//                      [--baseline path] [--threshold fraction] [--quick]
+//
+// Results go to stdout (or --output) as CSV or JSON with ns/op and ops/s;
+// for scenes an op is one step. With --baseline, a CSV or JSON file from an
+// earlier run, any benchmark slower than baseline * (1 + threshold) is
+// reported on stderr and the exit code is 1.
+//
+
+#include <chrono>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <core.hpp>
+#include <groundcontact.hpp>
+#include <particle.hpp>
+#include <pcontactparallelresolver.hpp>
+#include <rigidbody.hpp>
+#include <simulation.hpp>
+
+#include "benchutil.hpp"
+
+static const unsigned INPUT_COUNT = 1024;
+static const float TIME_STEP = 1.0f / 60.0f;
+static const unsigned SCENE_STEPS = 300;
+static const unsigned SCENE_WARMUP_STEPS = 60;
+static const unsigned REPETITIONS = 5;
+
+struct Result
+{
+    std::string name;
+
+    double nsPerOp;
+
+    double opsPerSecond;
+};
+
+// Scalar results feed this so the compiler can't drop the work
+static volatile float sink;
+
+static std::vector<Vector3> vectorsA;
+static std::vector<Vector3> vectorsB;
+static std::vector<Quaternion> quaternionsA;
+static std::vector<Quaternion> quaternionsB;
+static std::vector<Matrix3x3> matrices3A;
+static std::vector<Matrix3x3> matrices3B;
+static std::vector<Matrix3x4> matrices4A;
+static std::vector<Matrix3x4> matrices4B;
+static std::vector<Particle> particles;
+static std::vector<RigidBody> bodies;
+
+// Whole results are stored so no part of an operation can be optimised away
+static std::vector<Vector3> vectorsOut(INPUT_COUNT);
+static std::vector<Quaternion> quaternionsOut(INPUT_COUNT);
+static std::vector<Matrix3x3> matrices3Out(INPUT_COUNT);
+static std::vector<Matrix3x4> matrices4Out(INPUT_COUNT);
+
+static void buildInputs()
+{
+    unsigned state = 1234u;
+    for (unsigned i = 0; i < INPUT_COUNT; i++)
+    {
+        vectorsA.push_back(Vector3(randomFloat(state, -10.0f, 10.0f), randomFloat(state, -10.0f, 10.0f), randomFloat(state, -10.0f, 10.0f)));
+        vectorsB.push_back(Vector3(randomFloat(state, -10.0f, 10.0f), randomFloat(state, -10.0f, 10.0f), randomFloat(state, -10.0f, 10.0f)));
+        quaternionsA.push_back(randomQuaternion(state));
+        quaternionsB.push_back(randomQuaternion(state));
+
+        Matrix3x3 m3;
+        m3.setOrientation(quaternionsA[i]);
+        matrices3A.push_back(m3 * Matrix3x3(2.0f, 0, 0, 0, 3.0f, 0, 0, 0, 4.0f));
+        m3.setOrientation(quaternionsB[i]);
+        matrices3B.push_back(m3);
+
+        Matrix3x4 m4;
+        m4.setOrientationAndPos(quaternionsA[i], vectorsA[i]);
+        matrices4A.push_back(m4);
+        m4.setOrientationAndPos(quaternionsB[i], vectorsB[i]);
+        matrices4B.push_back(m4);
+
+        Particle particle;
+        particle.setPosition(vectorsA[i]);
+        particle.setVelocity(vectorsB[i]);
+        particle.setAcceleration(Vector3::GRAVITY);
+        particle.setDamping(0.99f);
+        particle.setMass(randomFloat(state, 0.5f, 5.0f));
+        particle.setCanSleep(false);
+        particles.push_back(particle);
+
+        RigidBody body;
+        body.setPosition(vectorsA[i]);
+        body.setOrientation(quaternionsA[i].x, quaternionsA[i].y, quaternionsA[i].z, quaternionsA[i].w);
+        body.setVelocity(vectorsB[i].x, vectorsB[i].y, vectorsB[i].z);
+        body.setAcceleration(Vector3::GRAVITY);
+        body.setMass(randomFloat(state, 0.5f, 5.0f));
+        body.setLinearDamping(0.99f);
+        body.setAngularDamping(0.99f);
+        body.setInertiaTensor(Matrix3x3(1.0f, 0.1f, 0, 0.1f, 2.0f, 0, 0, 0, 3.0f));
+        body.setCanSleep(false);
+        body.clearAccumulators();
+        body.calculateDerivedData();
+        bodies.push_back(body);
+    }
+}
+
+// Each micro benchmark runs its operation once per input and returns the op count
+typedef unsigned (*MicroBenchmark)();
+
+static unsigned vector3Add()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) vectorsOut[i] = vectorsA[i] + vectorsB[i];
+    return INPUT_COUNT;
+}
+
+static unsigned vector3Scale()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) vectorsOut[i] = vectorsA[i] * 0.5f;
+    return INPUT_COUNT;
+}
+
+static unsigned vector3Dot()
+{
+    float total = 0.0f;
+    for (unsigned i = 0; i < INPUT_COUNT; i++) total += vectorsA[i] * vectorsB[i];
+    sink = total;
+    return INPUT_COUNT;
+}
+
+static unsigned vector3Cross()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) vectorsOut[i] = Vector3::cross(vectorsA[i], vectorsB[i]);
+    return INPUT_COUNT;
+}
+
+static unsigned vector3AddScaled()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) vectorsOut[i].addScaledVector(vectorsA[i], 0.25f);
+    return INPUT_COUNT;
+}
+
+static unsigned quaternionMultiply()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++)
+    {
+        quaternionsOut[i] = quaternionsA[i];
+        quaternionsOut[i] *= quaternionsB[i];
+    }
+    return INPUT_COUNT;
+}
+
+static unsigned quaternionAddScaledVector()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++)
+    {
+        quaternionsOut[i] = quaternionsA[i];
+        quaternionsOut[i].addScaledVector(vectorsA[i], TIME_STEP);
+    }
+    return INPUT_COUNT;
+}
+
+static unsigned quaternionNormalize()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++)
+    {
+        quaternionsOut[i] = Quaternion(vectorsA[i].x, vectorsA[i].y, vectorsA[i].z, 1.0f);
+        quaternionsOut[i].normalize();
+    }
+    return INPUT_COUNT;
+}
+
+static unsigned matrix3x3Transform()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) vectorsOut[i] = matrices3A[i] * vectorsA[i];
+    return INPUT_COUNT;
+}
+
+static unsigned matrix3x3Multiply()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) matrices3Out[i] = matrices3A[i] * matrices3B[i];
+    return INPUT_COUNT;
+}
+
+static unsigned matrix3x3Inverse()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) matrices3Out[i].setInverse(matrices3A[i]);
+    return INPUT_COUNT;
+}
+
+static unsigned matrix3x3Transpose()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) matrices3Out[i].setTranspose(matrices3A[i]);
+    return INPUT_COUNT;
+}
+
+static unsigned matrix3x3SetOrientation()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) matrices3Out[i].setOrientation(quaternionsA[i]);
+    return INPUT_COUNT;
+}
+
+static unsigned matrix3x4Transform()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) vectorsOut[i] = matrices4A[i] * vectorsA[i];
+    return INPUT_COUNT;
+}
+
+static unsigned matrix3x4TransformInverse()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) vectorsOut[i] = matrices4A[i].transformInverse(vectorsA[i]);
+    return INPUT_COUNT;
+}
+
+static unsigned matrix3x4Multiply()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) matrices4Out[i] = matrices4A[i] * matrices4B[i];
+    return INPUT_COUNT;
+}
+
+static unsigned matrix3x4Inverse()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) matrices4Out[i].setInverse(matrices4A[i]);
+    return INPUT_COUNT;
+}
+
+static unsigned matrix3x4SetOrientationAndPos()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) matrices4Out[i].setOrientationAndPos(quaternionsA[i], vectorsA[i]);
+    return INPUT_COUNT;
+}
+
+static unsigned particleIntegrate()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) particles[i].integrate(TIME_STEP);
+    sink = particles[0].getPosition().x;
+    return INPUT_COUNT;
+}
+
+static unsigned rigidBodyIntegrate()
+{
+    for (unsigned i = 0; i < INPUT_COUNT; i++) bodies[i].integrate(TIME_STEP);
+    sink = bodies[0].getPosition().x;
+    return INPUT_COUNT;
+}
+
+static double elapsedNs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Repeats the benchmark until a run lasts minimumNs, then keeps the fastest of several runs
+static Result runMicro(const char* name, MicroBenchmark benchmark, double minimumNs)
+{
+    unsigned passes = 1;
+    for (;;)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (unsigned p = 0; p < passes; p++) benchmark();
+        if (elapsedNs(start) >= minimumNs) break;
+        passes *= 2;
+    }
+
+    double best = 0.0;
+    for (unsigned r = 0; r < REPETITIONS; r++)
+    {
+        unsigned ops = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (unsigned p = 0; p < passes; p++) ops += benchmark();
+        double nsPerOp = elapsedNs(start) / ops;
+        if (r == 0 || nsPerOp < best) best = nsPerOp;
+    }
+
+    Result result = { name, best, 1e9 / best };
+    return result;
+}
+
+// Particles in a grid just above the ground, kept awake so every step has contacts
+static void buildGroundScene(Simulation& simulation, GroundContact& ground, unsigned count)
+{
+    unsigned state = 99u;
+    unsigned side = (unsigned)ceilf(sqrtf((float)count));
+    for (unsigned i = 0; i < count; i++)
+    {
+        Particle* p = simulation.createParticle();
+        p->setPosition((i % side) * 2.0f, randomFloat(state, 0.0f, 0.5f), (i / side) * 2.0f);
+        p->setVelocity(0.0f, 0.0f, 0.0f);
+        p->setAcceleration(Vector3::GRAVITY);
+        p->setDamping(0.99f);
+        p->setMass(randomFloat(state, 0.5f, 5.0f));
+        p->setCanSleep(false);
+    }
+
+    ground.init(simulation.getParticles());
+    simulation.addContactGenerator(&ground);
+}
+
+static Result runScene(const char* name, unsigned count, ParticleContactResolver::Strategy strategy, unsigned threads, unsigned steps)
+{
+    ParticleContactParallelResolver parallel(0, threads > 1 ? threads : 1);
+
+    double best = 0.0;
+    for (unsigned r = 0; r < REPETITIONS; r++)
+    {
+        Simulation simulation(TIME_STEP, count);
+        simulation.getResolver().setStrategy(strategy);
+        if (threads > 1) simulation.setResolver(&parallel);
+        GroundContact ground;
+        buildGroundScene(simulation, ground, count);
+
+        for (unsigned step = 0; step < SCENE_WARMUP_STEPS; step++) simulation.step();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (unsigned step = 0; step < steps; step++) simulation.step();
+        double nsPerStep = elapsedNs(start) / steps;
+        if (r == 0 || nsPerStep < best) best = nsPerStep;
+
+        sink = simulation.getParticles()[0]->getPosition().y;
+    }
+
+    Result result = { name, best, 1e9 / best };
+    return result;
+}
+
+static void writeResults(FILE* file, const std::vector<Result>& results, bool json)
+{
+    if (json)
+    {
+        fprintf(file, "{\"results\":[\n");
+        for (unsigned i = 0; i < results.size(); i++)
+        {
+            fprintf(file, "{\"name\":\"%s\",\"ns_per_op\":%.4f,\"ops_per_sec\":%.1f}%s\n", results[i].name.c_str(),
+                results[i].nsPerOp, results[i].opsPerSecond, i + 1 < results.size() ? "," : "");
+        }
+        fprintf(file, "]}\n");
+    }
+    else
+    {
+        fprintf(file, "name,ns_per_op,ops_per_sec\n");
+        for (unsigned i = 0; i < results.size(); i++)
+        {
+            fprintf(file, "%s,%.4f,%.1f\n", results[i].name.c_str(), results[i].nsPerOp, results[i].opsPerSecond);
+        }
+    }
+}
+
+// Reads ns/op by name from a file written in either format
+static bool readBaseline(const char* path, std::map<std::string, double>& baseline)
+{
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+
+    char line[512];
+    while (fgets(line, sizeof(line), file))
+    {
+        char name[256];
+        double nsPerOp;
+        if (sscanf(line, "{\"name\":\"%255[^\"]\",\"ns_per_op\":%lf", name, &nsPerOp) == 2 ||
+            sscanf(line, "%255[^,],%lf", name, &nsPerOp) == 2)
+        {
+            baseline[name] = nsPerOp;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+static unsigned compareWithBaseline(const std::vector<Result>& results, const std::map<std::string, double>& baseline, double threshold)
+{
+    unsigned regressions = 0;
+    for (unsigned i = 0; i < results.size(); i++)
+    {
+        std::map<std::string, double>::const_iterator found = baseline.find(results[i].name);
+        if (found == baseline.end() || found->second <= 0.0) continue;
+
+        double ratio = results[i].nsPerOp / found->second;
+        bool regressed = ratio > 1.0 + threshold;
+        if (regressed) regressions++;
+
+        fprintf(stderr, "%-40s %12.4f ns/op vs %12.4f baseline (%+.1f%%)%s\n", results[i].name.c_str(), results[i].nsPerOp,
+            found->second, (ratio - 1.0) * 100.0, regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+int main(int argc, char* argv[])
+{
+    bool json = false;
+    bool quick = false;
+    const char* outputPath = NULL;
+    const char* baselinePath = NULL;
+    const char* filter = NULL;
+    double threshold = 0.10;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--format") && i + 1 < argc) json = !strcmp(argv[++i], "json");
+        else if (!strcmp(argv[i], "--output") && i + 1 < argc) outputPath = argv[++i];
+        else if (!strcmp(argv[i], "--baseline") && i + 1 < argc) baselinePath = argv[++i];
+        else if (!strcmp(argv[i], "--threshold") && i + 1 < argc) threshold = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--filter") && i + 1 < argc) filter = argv[++i];
+        else if (!strcmp(argv[i], "--quick")) quick = true;
+        else
+        {
+            fprintf(stderr, "usage: physics-bench [--format csv|json] [--output path] [--filter text] [--baseline path] [--threshold fraction] [--quick]\n");
+            return 2;
+        }
+    }
+
+    buildInputs();
+
+    struct Micro
+    {
+        const char* name;
+
+        MicroBenchmark benchmark;
+    };
+
+    const Micro micros[] = {
+        { "vector3_add", vector3Add },
+        { "vector3_scale", vector3Scale },
+        { "vector3_dot", vector3Dot },
+        { "vector3_cross", vector3Cross },
+        { "vector3_add_scaled", vector3AddScaled },
+        { "quaternion_multiply", quaternionMultiply },
+        { "quaternion_add_scaled_vector", quaternionAddScaledVector },
+        { "quaternion_normalize", quaternionNormalize },
+        { "matrix3x3_transform", matrix3x3Transform },
+        { "matrix3x3_multiply", matrix3x3Multiply },
+        { "matrix3x3_inverse", matrix3x3Inverse },
+        { "matrix3x3_transpose", matrix3x3Transpose },
+        { "matrix3x3_set_orientation", matrix3x3SetOrientation },
+        { "matrix3x4_transform", matrix3x4Transform },
+        { "matrix3x4_transform_inverse", matrix3x4TransformInverse },
+        { "matrix3x4_multiply", matrix3x4Multiply },
+        { "matrix3x4_inverse", matrix3x4Inverse },
+        { "matrix3x4_set_orientation_and_pos", matrix3x4SetOrientationAndPos },
+        { "particle_integrate", particleIntegrate },
+        { "rigidbody_integrate", rigidBodyIntegrate },
+    };
+
+    struct Scene
+    {
+        const char* name;
+
+        unsigned count;
+
+        ParticleContactResolver::Strategy strategy;
+
+        // More than one runs the parallel resolver instead of the strategy
+        unsigned threads;
+    };
+
+    // The linear scan is quadratic in contacts, so it only runs the smaller scenes
+    const Scene scenes[] = {
+        { "scene_ground_100_linear", 100, ParticleContactResolver::LINEAR_SCAN, 1 },
+        { "scene_ground_1000_linear", 1000, ParticleContactResolver::LINEAR_SCAN, 1 },
+        { "scene_ground_100_priority", 100, ParticleContactResolver::PRIORITY_QUEUE, 1 },
+        { "scene_ground_1000_priority", 1000, ParticleContactResolver::PRIORITY_QUEUE, 1 },
+        { "scene_ground_10000_priority", 10000, ParticleContactResolver::PRIORITY_QUEUE, 1 },
+        { "scene_ground_10000_parallel_4", 10000, ParticleContactResolver::PRIORITY_QUEUE, 4 },
+    };
+
+    double minimumNs = quick ? 2e6 : 2e7;
+    unsigned sceneSteps = quick ? SCENE_STEPS / 10 : SCENE_STEPS;
+
+    std::vector<Result> results;
+    for (unsigned i = 0; i < sizeof(micros) / sizeof(micros[0]); i++)
+    {
+        if (filter && !strstr(micros[i].name, filter)) continue;
+        results.push_back(runMicro(micros[i].name, micros[i].benchmark, minimumNs));
+    }
+    for (unsigned i = 0; i < sizeof(scenes) / sizeof(scenes[0]); i++)
+    {
+        if (filter && !strstr(scenes[i].name, filter)) continue;
+        results.push_back(runScene(scenes[i].name, scenes[i].count, scenes[i].strategy, scenes[i].threads, sceneSteps));
+    }
+
+    FILE* output = outputPath ? fopen(outputPath, "w") : stdout;
+    if (!output)
+    {
+        fprintf(stderr, "Failed to open %s\n", outputPath);
+        return 2;
+    }
+    writeResults(output, results, json);
+    if (output != stdout) fclose(output);
+
+    if (baselinePath)
+    {
+        std::map<std::string, double> baseline;
+        if (!readBaseline(baselinePath, baseline))
+        {
+            fprintf(stderr, "Failed to read baseline %s\n", baselinePath);
+            return 2;
+        }
+
+        unsigned regressions = compareWithBaseline(results, baseline, threshold);
+        if (regressions > 0)
+        {
+            fprintf(stderr, "%u benchmark(s) slower than baseline by more than %.0f%%\n", regressions, threshold * 100.0);
+            return 1;
+        }
+    }
+
+    return 0;
+}
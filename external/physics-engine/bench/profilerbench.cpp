@@ -0,0 +1,88 @@
+// profilerbench.cpp : Checks that the profiler frees the ring buffer of each
+// thread that records and then exits, keeping its events and dropped counts,
+// and times recording a zone.
+//
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include <profiler.hpp>
+
+static const unsigned THREAD_WAVES = 20;
+static const unsigned THREADS_PER_WAVE = 8;
+static const unsigned ZONES_PER_THREAD = 100;
+static const unsigned TIMED_ZONES = 1000000;
+
+static void recordZones()
+{
+    for (unsigned i = 0; i < ZONES_PER_THREAD; i++)
+    {
+        uint64_t start = Profiler::now();
+        Profiler::get().recordZone("worker", start, start + 1000);
+    }
+}
+
+int main()
+{
+    Profiler& profiler = Profiler::get();
+    bool reclaimed = true;
+
+    // The main thread keeps its buffer for the whole run
+    profiler.recordCounter("waves", THREAD_WAVES);
+    profiler.endFrame();
+    unsigned baseline = profiler.getBufferCount();
+
+    for (unsigned wave = 0; wave < THREAD_WAVES; wave++)
+    {
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < THREADS_PER_WAVE; t++)
+        {
+            threads.push_back(std::thread(recordZones));
+        }
+        for (unsigned t = 0; t < threads.size(); t++)
+        {
+            threads[t].join();
+        }
+
+        // Exited threads keep their buffers until the next frame drains them
+        if (profiler.getBufferCount() != baseline + THREADS_PER_WAVE) reclaimed = false;
+        profiler.endFrame();
+        if (profiler.getBufferCount() != baseline) reclaimed = false;
+    }
+
+    // Every worker's events made it into the statistics before its buffer went
+    std::vector<Profiler::Stats> stats;
+    profiler.getSummary(stats);
+    bool counted = false;
+    for (unsigned i = 0; i < stats.size(); i++)
+    {
+        if (stats[i].name != "worker") continue;
+        double expectedMs = THREADS_PER_WAVE * ZONES_PER_THREAD * 1000 / 1e6;
+        counted = stats[i].frames == THREAD_WAVES && fabs(stats[i].min - expectedMs) < 1e-9 && fabs(stats[i].max - expectedMs) < 1e-9;
+    }
+
+    // Timing; drained every few thousand zones so nothing is dropped
+    profiler.clear();
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < TIMED_ZONES; i++)
+    {
+        ProfileZone zone("timed");
+        if (i % 4096 == 4095) profiler.endFrame();
+    }
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    double zoneNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / TIMED_ZONES;
+
+    printf("threads,buffers_after_exit,zone_ns,dropped\n");
+    printf("%u,%u,%.1f,%lu\n", THREAD_WAVES * THREADS_PER_WAVE, profiler.getBufferCount(), zoneNs, profiler.getDroppedCount());
+
+    if (!reclaimed || !counted || profiler.getDroppedCount() != 0)
+    {
+        printf("Profiler kept buffers of exited threads or lost their events\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+// resolverbench.cpp : Compares the linear-scan and priority-queue contact
+// resolvers on stacks of resting particles. LINEAR_SCAN is the original
+// resolver loop plus penetration tracking, and the priority queue must match
+// it within tolerance while its speedup grows with the contact count.
+// The parallel resolver must give the same result for any thread count.
+//
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include <particle.hpp>
+#include <pcontact.hpp>
+#include <pcontactparallelresolver.hpp>
+#include <pcontactresolver.hpp>
+
+static const unsigned STACK_HEIGHT = 4;
+
+struct Scene
+{
+    std::vector<Particle> particles;
+
+    std::vector<ParticleContact> contacts;
+};
+
+// Builds columns of particles that each sit on the ground and on each other
+static void buildScene(Scene& scene, unsigned numContacts)
+{
+    unsigned columns = numContacts / STACK_HEIGHT;
+    scene.particles.resize(columns * STACK_HEIGHT);
+    scene.contacts.clear();
+
+    for (unsigned c = 0; c < columns; c++)
+    {
+        for (unsigned h = 0; h < STACK_HEIGHT; h++)
+        {
+            Particle& p = scene.particles[c * STACK_HEIGHT + h];
+            p.setPosition(c * 2.0f, h * 0.99f - 0.01f, 0.0f);
+            p.setVelocity(0.0f, -1.0f - 0.1f * ((c + h) % 7), 0.0f);
+            p.setAcceleration(Vector3::GRAVITY);
+            p.setDamping(0.99f);
+            p.setMass(1.0f + h);
+        }
+    }
+
+    for (unsigned c = 0; c < columns; c++)
+    {
+        Particle* column = &scene.particles[c * STACK_HEIGHT];
+
+        ParticleContact ground;
+        ground.particle[0] = &column[0];
+        ground.particle[1] = NULL;
+        ground.contactNormal = Vector3::UP;
+        ground.penetration = 0.01f;
+        ground.restitution = 0.2f;
+        scene.contacts.push_back(ground);
+
+        for (unsigned h = 1; h < STACK_HEIGHT; h++)
+        {
+            ParticleContact stacked;
+            stacked.particle[0] = &column[h];
+            stacked.particle[1] = &column[h - 1];
+            stacked.contactNormal = Vector3::UP;
+            stacked.penetration = 0.01f;
+            stacked.restitution = 0.2f;
+            scene.contacts.push_back(stacked);
+        }
+    }
+}
+
+static double resolve(Scene& scene, ParticleContactResolver::Strategy strategy, unsigned* iterationsUsed)
+{
+    unsigned numContacts = (unsigned)scene.contacts.size();
+    ParticleContactResolver resolver(numContacts * 2, strategy);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    resolver.resolveContacts(&scene.contacts[0], numContacts, 1.0f / 60.0f);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    *iterationsUsed = resolver.getIterationsUsed();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static double resolveParallel(Scene& scene, unsigned threadCount, unsigned* iterationsUsed)
+{
+    unsigned numContacts = (unsigned)scene.contacts.size();
+    ParticleContactParallelResolver resolver(numContacts * 2, threadCount);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    resolver.resolveContacts(&scene.contacts[0], numContacts, 1.0f / 60.0f);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    *iterationsUsed = resolver.getIterationsUsed();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static float maxDifference(const Scene& a, const Scene& b)
+{
+    float result = 0.0f;
+    for (unsigned i = 0; i < a.particles.size(); i++)
+    {
+        Vector3 dp = a.particles[i].getPosition() - b.particles[i].getPosition();
+        Vector3 dv = a.particles[i].getVelocity() - b.particles[i].getVelocity();
+        float d = fabsf(dp.x) + fabsf(dp.y) + fabsf(dp.z) + fabsf(dv.x) + fabsf(dv.y) + fabsf(dv.z);
+        if (d > result) result = d;
+    }
+    return result;
+}
+
+int main()
+{
+    const unsigned contactCounts[] = { 256, 1024, 4096, 8192 };
+    const float tolerance = 1e-4f;
+    bool matched = true;
+    bool deterministic = true;
+
+    unsigned threadCount = std::thread::hardware_concurrency();
+    if (threadCount < 4) threadCount = 4;
+
+    printf("contacts,iterations,linear_ms,priority_ms,speedup,max_difference,threads,parallel_ms\n");
+
+    for (unsigned n = 0; n < sizeof(contactCounts) / sizeof(contactCounts[0]); n++)
+    {
+        Scene linear;
+        Scene priority;
+        Scene serial;
+        Scene parallel;
+        buildScene(linear, contactCounts[n]);
+        buildScene(priority, contactCounts[n]);
+        buildScene(serial, contactCounts[n]);
+        buildScene(parallel, contactCounts[n]);
+
+        unsigned linearIterations;
+        unsigned priorityIterations;
+        double linearMs = resolve(linear, ParticleContactResolver::LINEAR_SCAN, &linearIterations);
+        double priorityMs = resolve(priority, ParticleContactResolver::PRIORITY_QUEUE, &priorityIterations);
+
+        float difference = maxDifference(linear, priority);
+        if (difference > tolerance || linearIterations != priorityIterations) matched = false;
+
+        unsigned serialIterations;
+        unsigned parallelIterations;
+        resolveParallel(serial, 1, &serialIterations);
+        double parallelMs = resolveParallel(parallel, threadCount, &parallelIterations);
+        if (maxDifference(serial, parallel) != 0.0f || serialIterations != parallelIterations) deterministic = false;
+
+        printf("%u,%u,%.3f,%.3f,%.1f,%g,%u,%.3f\n", contactCounts[n], priorityIterations, linearMs, priorityMs,
+            priorityMs > 0.0 ? linearMs / priorityMs : 0.0, difference, threadCount, parallelMs);
+    }
+
+    if (!matched)
+    {
+        printf("priority resolver diverged from the linear resolver\n");
+        return 1;
+    }
+
+    if (!deterministic)
+    {
+        printf("parallel resolver depends on the thread count\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,136 @@
+// rigidbodybench.cpp : Checks RigidBodyWorld against the scalar RigidBody
+// path within float tolerance, then compares their integration throughput.
+//
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#include <rigidbody.hpp>
+#include <rigidbodyworld.hpp>
+
+#include "benchutil.hpp"
+
+static const unsigned STEPS = 100;
+static const float TIME_STEP = 1.0f / 60.0f;
+
+static void buildBodies(std::vector<RigidBody>& bodies, unsigned count)
+{
+    unsigned state = 4242u;
+    bodies.resize(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        initRandomBody(bodies[i], state, 100.0f);
+    }
+}
+
+static float compareBodies(const RigidBody& expected, const RigidBody& actual)
+{
+    float error = 0.0f;
+    Vector3 vectors[4][2] = {
+        { expected.getPosition(), actual.getPosition() },
+        { expected.getVelocity(), actual.getVelocity() },
+        { expected.getLastFrameAcceleration(), actual.getLastFrameAcceleration() },
+        { expected.getPointInWorldSpace(Vector3(1, 2, 3)), actual.getPointInWorldSpace(Vector3(1, 2, 3)) },
+    };
+    for (unsigned v = 0; v < 4; v++)
+    {
+        error = fmaxf(error, relativeError(vectors[v][0], vectors[v][1]));
+    }
+
+    Quaternion q0 = expected.getOrientation();
+    Quaternion q1 = actual.getOrientation();
+    for (unsigned k = 0; k < 4; k++)
+    {
+        error = fmaxf(error, relativeError(q0.data[k], q1.data[k]));
+    }
+
+    Matrix3x3 i0 = expected.getInverseInertiaTensorWorld();
+    Matrix3x3 i1 = actual.getInverseInertiaTensorWorld();
+    for (unsigned k = 0; k < 9; k++)
+    {
+        error = fmaxf(error, relativeError(i0.data[k], i1.data[k]));
+    }
+
+    return error;
+}
+
+int main()
+{
+    const unsigned bodyCounts[] = { 103, 1003, 10003 };
+    const float tolerance = 1e-4f;
+    bool matched = true;
+
+    printf("bodies,steps,scalar_ms,world_scalar_ms,world_simd_ms,speedup,max_relative_error\n");
+
+    for (unsigned n = 0; n < sizeof(bodyCounts) / sizeof(bodyCounts[0]); n++)
+    {
+        std::vector<RigidBody> reference;
+        buildBodies(reference, bodyCounts[n]);
+
+        RigidBodyWorld simd;
+        RigidBodyWorld scalar;
+        std::vector<RigidBodyHandle> handles;
+        for (unsigned i = 0; i < reference.size(); i++)
+        {
+            handles.push_back(simd.addBody(reference[i]));
+            scalar.addBody(reference[i]);
+        }
+
+        double referenceMs = 0.0;
+        double scalarMs = 0.0;
+        double simdMs = 0.0;
+
+        for (unsigned step = 0; step < STEPS; step++)
+        {
+            // Push every body off-centre so torque and the inertia tensor matter
+            for (unsigned i = 0; i < reference.size(); i++)
+            {
+                Vector3 force(0.0f, 5.0f + i % 3, 1.0f);
+                Vector3 point = reference[i].getPosition() + Vector3(0.5f, 0.0f, -0.25f);
+                reference[i].addForceAtPoint(force, point);
+                simd.addForceAtPoint(handles[i], force, simd.getPosition(handles[i]) + Vector3(0.5f, 0.0f, -0.25f));
+                scalar.addForceAtPoint(handles[i], force, scalar.getPosition(handles[i]) + Vector3(0.5f, 0.0f, -0.25f));
+            }
+
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            for (unsigned i = 0; i < reference.size(); i++)
+            {
+                reference[i].integrate(TIME_STEP);
+            }
+            std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+            scalar.integrateScalar(TIME_STEP);
+            std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+            simd.integrate(TIME_STEP);
+            std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+
+            referenceMs += elapsedMs(t0, t1);
+            scalarMs += elapsedMs(t1, t2);
+            simdMs += elapsedMs(t2, t3);
+        }
+
+        float error = 0.0f;
+        for (unsigned i = 0; i < reference.size(); i++)
+        {
+            RigidBody fromSimd;
+            RigidBody fromScalar;
+            simd.getBody(handles[i], &fromSimd);
+            scalar.getBody(handles[i], &fromScalar);
+            error = fmaxf(error, compareBodies(reference[i], fromSimd));
+            error = fmaxf(error, compareBodies(reference[i], fromScalar));
+        }
+        if (!(error <= tolerance)) matched = false;
+
+        printf("%u,%u,%.3f,%.3f,%.3f,%.1f,%g\n", bodyCounts[n], STEPS, referenceMs, scalarMs, simdMs,
+            simdMs > 0.0 ? referenceMs / simdMs : 0.0, error);
+    }
+
+    if (!matched)
+    {
+        printf("RigidBodyWorld diverged from RigidBody::integrate\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,309 @@
+// sleepbench.cpp : Checks sleeping in ParticleWorld and RigidBodyWorld against
+// Particle and RigidBody: objects fall asleep at the same step, sleeping ones
+// are not integrated, and contacts and forces wake them. Then checks that a
+// Simulation at rest generates no contacts until a falling particle wakes the
+// one it lands on, and times worlds that are asleep against awake ones.
+//
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#include <groundcontact.hpp>
+#include <particle.hpp>
+#include <particleworld.hpp>
+#include <pcontact.hpp>
+#include <pcontactresolver.hpp>
+#include <rigidbody.hpp>
+#include <rigidbodyworld.hpp>
+#include <simulation.hpp>
+#include <uniformgridcontact.hpp>
+
+#include "benchutil.hpp"
+
+static const float TIME_STEP = 1.0f / 60.0f;
+static const unsigned SETTLE_STEPS = 600;
+static const float TOLERANCE = 1e-4f;
+
+static bool failed = false;
+
+static void check(bool condition, const char* what)
+{
+    if (condition) return;
+    printf("FAILED: %s\n", what);
+    failed = true;
+}
+
+static bool samePosition(const Vector3& a, const Vector3& b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+// Steps the reference objects and their copies in two worlds, one through
+// the vector path and one through the scalar path, until everything that can
+// sleep has settled. Checks after every step that both worlds put the same
+// objects to sleep as the reference and stay within tolerance of it.
+template <class Object, class World>
+static void settle(std::vector<Object>& reference, World& simd, World& scalar, const char* sameAwakeWhat, const char* matchWhat)
+{
+    bool sameAwake = true;
+    float error = 0.0f;
+    for (unsigned step = 0; step < SETTLE_STEPS; step++)
+    {
+        for (unsigned i = 0; i < reference.size(); i++) reference[i].integrate(TIME_STEP);
+        simd.integrate(TIME_STEP);
+        scalar.integrateScalar(TIME_STEP);
+
+        for (unsigned handle = 0; handle < reference.size(); handle++)
+        {
+            bool awake = reference[handle].getAwake();
+            if (simd.getAwake(handle) != awake || scalar.getAwake(handle) != awake) sameAwake = false;
+            error = fmaxf(error, worldError(reference[handle], simd, handle));
+            error = fmaxf(error, worldError(reference[handle], scalar, handle));
+        }
+    }
+    check(sameAwake, sameAwakeWhat);
+    check(error <= TOLERANCE, matchWhat);
+}
+
+// Drifting with no acceleration and heavy damping, so every particle that
+// can sleep settles within a few seconds
+static Particle restlessParticle(unsigned& state, unsigned i)
+{
+    Particle particle;
+    particle.setPosition(randomFloat(state, -50.0f, 50.0f), randomFloat(state, 0.0f, 50.0f), randomFloat(state, -50.0f, 50.0f));
+    particle.setVelocity(randomFloat(state, -2.0f, 2.0f), randomFloat(state, -2.0f, 2.0f), randomFloat(state, -2.0f, 2.0f));
+    particle.setAcceleration(Vector3());
+    particle.setDamping(randomFloat(state, 0.2f, 0.5f));
+    particle.setMass(randomFloat(state, 0.5f, 5.0f));
+    if (i % 7 == 0) particle.setCanSleep(false);
+    return particle;
+}
+
+static void checkParticleWorlds()
+{
+    const unsigned count = 1003;
+    unsigned state = 99u;
+
+    std::vector<Particle> reference;
+    ParticleWorld simd;
+    ParticleWorld scalar;
+    for (unsigned i = 0; i < count; i++)
+    {
+        reference.push_back(restlessParticle(state, i));
+        simd.addParticle(reference[i]);
+        scalar.addParticle(reference[i]);
+    }
+
+    // Views are stepped apart from the vector kernels, so cover both
+    for (ParticleHandle handle = 0; handle < count; handle += 5)
+    {
+        simd.getParticle(handle);
+        scalar.getParticle(handle);
+    }
+
+    settle(reference, simd, scalar, "ParticleWorld particles fall asleep at the same step as Particle",
+        "ParticleWorld matches Particle while particles fall asleep");
+
+    unsigned asleep = 0;
+    for (ParticleHandle handle = 0; handle < count; handle++)
+    {
+        if (!simd.getAwake(handle)) asleep++;
+        if (handle % 7 == 0) check(simd.getAwake(handle), "particles that cannot sleep stay awake");
+    }
+    check(asleep == count - (count + 6) / 7, "every particle that can sleep is asleep");
+
+    // Velocity set without waking is ignored while asleep, in a view or not
+    const ParticleHandle viewed = 5;
+    const ParticleHandle packed = 6;
+    Vector3 before[2] = { simd.getPosition(viewed), simd.getPosition(packed) };
+    simd.setVelocity(viewed, Vector3(1.0f, 0.0f, 0.0f));
+    simd.setVelocity(packed, Vector3(1.0f, 0.0f, 0.0f));
+    simd.integrate(TIME_STEP);
+    check(samePosition(simd.getPosition(viewed), before[0]) && samePosition(simd.getPosition(packed), before[1]), "sleeping particles are not integrated");
+
+    // An awake particle hitting a sleeping one wakes it
+    const ParticleHandle hit = 10;
+    simd.setAwake(packed);
+    ParticleContact contact;
+    contact.particle[0] = simd.getParticle(packed);
+    contact.particle[1] = simd.getParticle(hit);
+    contact.contactNormal = Vector3(-1.0f, 0.0f, 0.0f);
+    contact.penetration = 0.1f;
+    contact.restitution = 0.5f;
+    Vector3 hitBefore = simd.getPosition(hit);
+    ParticleContactResolver resolver(2);
+    resolver.resolveContacts(&contact, 1, TIME_STEP);
+    simd.integrate(TIME_STEP);
+    check(simd.getAwake(hit), "a contact with an awake particle wakes a sleeping one");
+    check(!samePosition(simd.getPosition(hit), hitBefore), "a woken particle is integrated");
+}
+
+static void checkRigidBodyWorlds()
+{
+    const unsigned count = 1003;
+    unsigned state = 7u;
+
+    std::vector<RigidBody> reference(count);
+    RigidBodyWorld simd;
+    RigidBodyWorld scalar;
+    for (unsigned i = 0; i < count; i++)
+    {
+        initRandomBody(reference[i], state, 100.0f);
+        reference[i].setAcceleration(Vector3());
+        reference[i].setVelocity(randomFloat(state, -2.0f, 2.0f), randomFloat(state, -2.0f, 2.0f), randomFloat(state, -2.0f, 2.0f));
+        reference[i].setLinearDamping(randomFloat(state, 0.2f, 0.5f));
+        reference[i].setAngularDamping(randomFloat(state, 0.2f, 0.5f));
+        if (i % 7 == 0) reference[i].setCanSleep(false);
+        simd.addBody(reference[i]);
+        scalar.addBody(reference[i]);
+
+        // Set them spinning too
+        Vector3 torque(randomFloat(state, -1.0f, 1.0f), randomFloat(state, -1.0f, 1.0f), randomFloat(state, -1.0f, 1.0f));
+        reference[i].addTorque(torque);
+        simd.addTorque(i, torque);
+        scalar.addTorque(i, torque);
+    }
+
+    settle(reference, simd, scalar, "RigidBodyWorld bodies fall asleep at the same step as RigidBody",
+        "RigidBodyWorld matches RigidBody while bodies fall asleep");
+
+    unsigned asleep = 0;
+    for (RigidBodyHandle handle = 0; handle < count; handle++)
+    {
+        if (!simd.getAwake(handle)) asleep++;
+    }
+    check(asleep == count - (count + 6) / 7, "every body that can sleep is asleep");
+
+    // Velocity set without waking is ignored while asleep
+    const RigidBodyHandle body = 1;
+    Vector3 before = simd.getPosition(body);
+    simd.setVelocity(body, Vector3(1.0f, 0.0f, 0.0f));
+    simd.integrate(TIME_STEP);
+    check(samePosition(simd.getPosition(body), before), "sleeping bodies are not integrated");
+
+    // A force wakes a body, in the world as on its own
+    Vector3 force(0.0f, 10.0f, 0.0f);
+    Vector3 point = reference[body].getPosition() + Vector3(0.5f, 0.0f, 0.0f);
+    reference[body].setVelocity(1.0f, 0.0f, 0.0f);
+    reference[body].addForceAtPoint(force, point);
+    simd.addForceAtPoint(body, force, point);
+    check(simd.getAwake(body), "addForceAtPoint wakes a sleeping body");
+
+    reference[body].integrate(TIME_STEP);
+    simd.integrate(TIME_STEP);
+    RigidBody stepped;
+    simd.getBody(body, &stepped);
+    check(stepped.getAwake() && relativeError(reference[body].getPosition(), stepped.getPosition()) <= TOLERANCE,
+        "a woken body is integrated like RigidBody");
+}
+
+// A layer of particles settles on the ground while one more falls from high
+// above onto the first of them
+static void checkSimulation()
+{
+    const unsigned side = 10;
+    const float radius = 0.5f;
+
+    Simulation simulation(TIME_STEP, 256);
+    for (unsigned i = 0; i < side * side; i++)
+    {
+        Particle* p = simulation.createParticle();
+        p->setPosition((i % side) * radius * 3.0f, radius, (i / side) * radius * 3.0f);
+        p->setVelocity(0.0f, 0.0f, 0.0f);
+        p->setAcceleration(Vector3::GRAVITY);
+        p->setDamping(0.99f);
+        p->setMass(1.0f);
+    }
+    Particle* dropped = simulation.createParticle();
+    dropped->setPosition(0.0f, 120.0f, 0.0f);
+    dropped->setVelocity(0.0f, 0.0f, 0.0f);
+    dropped->setAcceleration(Vector3::GRAVITY);
+    dropped->setDamping(0.99f);
+    dropped->setMass(1.0f);
+
+    GroundContact ground;
+    UniformGridContact collision;
+    ground.init(simulation.getParticles());
+    collision.init(simulation.getParticles(), radius);
+    simulation.addContactGenerator(&ground);
+    simulation.addContactGenerator(&collision);
+
+    Particle* landing = simulation.getParticles()[0];
+    bool settled = false;
+    bool woken = false;
+    for (unsigned step = 0; step < SETTLE_STEPS; step++)
+    {
+        bool wasAwake = landing->getAwake();
+        simulation.step();
+
+        unsigned awake = 0;
+        for (unsigned i = 0; i < side * side; i++)
+        {
+            if (simulation.getParticles()[i]->getAwake()) awake++;
+        }
+
+        // Still in the air when the layer settles, so nothing is touching
+        if (!settled && awake == 0 && dropped->getPosition().y > radius * 4.0f)
+        {
+            settled = true;
+            check(simulation.getContactCount() == 0, "a scene at rest generates no contacts");
+        }
+        if (settled && !wasAwake && landing->getAwake()) woken = true;
+    }
+
+    check(settled, "the particle layer falls asleep");
+    check(woken, "the falling particle wakes the one it lands on");
+}
+
+template <class World>
+static double timeIntegrate(World& world)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned step = 0; step < 100; step++) world.integrate(TIME_STEP);
+    return elapsedMs(start, std::chrono::steady_clock::now());
+}
+
+int main()
+{
+    checkParticleWorlds();
+    checkRigidBodyWorlds();
+    checkSimulation();
+
+    // 100 steps of worlds where nothing is awake and where everything is
+    const unsigned particleCount = 100003;
+    const unsigned bodyCount = 10003;
+    unsigned state = 5u;
+
+    ParticleWorld awakeParticles;
+    ParticleWorld sleepingParticles;
+    for (unsigned i = 0; i < particleCount; i++)
+    {
+        Particle particle = restlessParticle(state, 1);
+        particle.setCanSleep(false);
+        awakeParticles.addParticle(particle);
+        particle.setCanSleep(true);
+        particle.setAwake(false);
+        sleepingParticles.addParticle(particle);
+    }
+
+    RigidBodyWorld awakeBodies;
+    RigidBodyWorld sleepingBodies;
+    for (unsigned i = 0; i < bodyCount; i++)
+    {
+        RigidBody body;
+        initRandomBody(body, state, 100.0f);
+        body.setCanSleep(false);
+        awakeBodies.addBody(body);
+        body.setCanSleep(true);
+        body.setAwake(false);
+        sleepingBodies.addBody(body);
+    }
+
+    printf("world,objects,steps,awake_ms,asleep_ms\n");
+    printf("particles,%u,100,%.3f,%.3f\n", particleCount, timeIntegrate(awakeParticles), timeIntegrate(sleepingParticles));
+    printf("rigid_bodies,%u,100,%.3f,%.3f\n", bodyCount, timeIntegrate(awakeBodies), timeIntegrate(sleepingBodies));
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,219 @@
+// snapshotbench.cpp : Times Snapshot capture and restore on 10k rigid bodies
+// plus particles in contact, then checks that restoring a snapshot and
+// re-simulating reproduces the original run bit for bit, both from memory
+// and from a session streamed through SnapshotRecorder and SnapshotReader.
+// Fails if a capture or a recorded frame costs the stepping thread a
+// millisecond or more: CPU time always, and wall time too when the recorder's
+// writer has a core of its own.
+// Usage: physics-snapshot-bench [session file]; by default the session goes
+// to the temp directory and is removed afterwards.
+//
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <groundcontact.hpp>
+#include <simulation.hpp>
+#include <snapshot.hpp>
+#include <snapshotrecorder.hpp>
+#include <sweepprunecontact.hpp>
+
+#include "benchutil.hpp"
+
+static const float TIME_STEP = 1.0f / 60.0f;
+static const unsigned BODY_COUNT = 10000;
+static const unsigned PARTICLE_COUNT = 1000;
+static const unsigned WARMUP_STEPS = 60;
+static const unsigned REPLAY_STEPS = 120;
+static const unsigned TIMING_RUNS = 100;
+static const float SLEEP_EPSILON = 0.25f;
+static const double FRAME_BUDGET_MS = 1.0;
+
+// Sweep-and-prune keeps an order between steps, which a replay must not depend on
+static void buildScene(Simulation& simulation, GroundContact& ground, SweepPruneContact& collision)
+{
+    unsigned state = 777u;
+    for (unsigned i = 0; i < BODY_COUNT; i++)
+    {
+        initRandomBody(*simulation.getRigidBody(simulation.createRigidBody()), state, 200.0f);
+    }
+
+    // A pile of particles so every step has ground and particle-particle contacts
+    buildParticleBlock(simulation, PARTICLE_COUNT, 20, 0.5f, state);
+
+    ground.init(simulation.getParticles());
+    collision.init(simulation.getParticles(), 0.5f);
+    simulation.addContactGenerator(&ground);
+    simulation.addContactGenerator(&collision);
+}
+
+// Deterministic input so a replay sees the same forces
+static void step(Simulation& simulation)
+{
+    unsigned frame = simulation.getStepCount();
+    for (unsigned i = frame % 7; i < BODY_COUNT; i += 7)
+    {
+        RigidBody* body = simulation.getRigidBody(i);
+        body->addForceAtPoint(Vector3(0.0f, 20.0f, 1.0f), body->getPosition() + Vector3(0.5f, 0.0f, 0.0f));
+    }
+    simulation.step();
+}
+
+static bool sameSnapshot(const Snapshot& a, const Snapshot& b)
+{
+    return a.getSize() == b.getSize() && memcmp(a.getData(), b.getData(), a.getSize()) == 0;
+}
+
+static std::string tempSessionPath()
+{
+    const char* names[] = { "TMPDIR", "TEMP", "TMP" };
+    for (unsigned i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        const char* directory = getenv(names[i]);
+        if (directory && *directory) return std::string(directory) + "/physics-snapshot-session.bin";
+    }
+    return "/tmp/physics-snapshot-session.bin";
+}
+
+int main(int argc, char* argv[])
+{
+    std::string defaultPath = tempSessionPath();
+    const char* sessionPath = argc > 1 ? argv[1] : defaultPath.c_str();
+
+    Simulation simulation(TIME_STEP, 1024);
+    GroundContact ground;
+    SweepPruneContact collision;
+    buildScene(simulation, ground, collision);
+    setSleepEpsilon(SLEEP_EPSILON);
+
+    for (unsigned i = 0; i < WARMUP_STEPS; i++) step(simulation);
+
+    // Timing
+    Snapshot start;
+    start.capture(simulation);
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < TIMING_RUNS; i++) start.capture(simulation);
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < TIMING_RUNS; i++) start.restore(simulation);
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+    double captureMs = elapsedMs(t0, t1) / TIMING_RUNS;
+    double restoreMs = elapsedMs(t1, t2) / TIMING_RUNS;
+
+    // Original run, streamed to the session file
+    SnapshotRecorder recorder;
+    if (!recorder.open(sessionPath))
+    {
+        printf("Failed to open %s\n", sessionPath);
+        return 1;
+    }
+
+    Snapshot frame;
+    Snapshot previous = start;
+    std::vector<unsigned char> delta;
+    size_t deltaBytes = 0;
+    double deltaMs = 0.0;
+    double recordMs = 0.0;
+    double recordCpuMs = 0.0;
+
+    recorder.record(simulation);
+    for (unsigned i = 0; i < REPLAY_STEPS; i++)
+    {
+        step(simulation);
+        frame.capture(simulation);
+
+        std::chrono::steady_clock::time_point d0 = std::chrono::steady_clock::now();
+        frame.encodeDelta(previous, delta);
+        deltaMs += elapsedMs(d0, std::chrono::steady_clock::now());
+        deltaBytes += delta.size();
+
+        // The delta must rebuild the frame from the one before it
+        Snapshot rebuilt = previous;
+        if (!rebuilt.applyDelta(&delta[0], delta.size()) || !sameSnapshot(rebuilt, frame))
+        {
+            printf("Delta round trip failed at step %u\n", simulation.getStepCount());
+            return 1;
+        }
+
+        // Only the time the stepping thread spends in record(); the writer
+        // encodes and appends behind it
+        double cpu0 = threadCpuMs();
+        std::chrono::steady_clock::time_point r0 = std::chrono::steady_clock::now();
+        bool queued = recorder.record(simulation);
+        recordMs += elapsedMs(r0, std::chrono::steady_clock::now());
+        recordCpuMs += threadCpuMs() - cpu0;
+        if (!queued)
+        {
+            printf("Recording failed at step %u\n", simulation.getStepCount());
+            return 1;
+        }
+
+        previous.swap(frame);
+    }
+    Snapshot finalState = previous;
+    if (!recorder.flush() || recorder.getFrameCount() != REPLAY_STEPS + 1 || !sameSnapshot(recorder.getLastFrame(), finalState))
+    {
+        printf("Recorder did not write every frame\n");
+        return 1;
+    }
+    size_t sessionBytes = recorder.getSize();
+    recorder.close();
+
+    // Re-simulate from the restored start and compare against the recording;
+    // the sleep epsilon must come back with it
+    setSleepEpsilon(2.0f * SLEEP_EPSILON);
+    if (!start.restore(simulation) || getSleepEpsilon() != SLEEP_EPSILON)
+    {
+        printf("Restore rejected the snapshot\n");
+        return 1;
+    }
+
+    SnapshotReader reader;
+    Snapshot recorded;
+    if (!reader.open(sessionPath) || !reader.next(recorded) || !sameSnapshot(recorded, start))
+    {
+        printf("Failed to read back %s\n", sessionPath);
+        return 1;
+    }
+
+    bool exact = true;
+    for (unsigned i = 0; i < REPLAY_STEPS; i++)
+    {
+        step(simulation);
+        frame.capture(simulation);
+
+        if (!reader.next(recorded) || !sameSnapshot(recorded, frame))
+        {
+            printf("Re-simulation diverged from the recording at step %u\n", simulation.getStepCount());
+            exact = false;
+            break;
+        }
+    }
+    if (exact && !sameSnapshot(frame, finalState))
+    {
+        printf("Re-simulation diverged from the original run\n");
+        exact = false;
+    }
+    reader.close();
+    remove(sessionPath);
+
+    printf("bodies,particles,contacts,snapshot_bytes,capture_ms,restore_ms,avg_delta_bytes,avg_delta_ms,avg_record_ms,avg_record_cpu_ms,session_bytes,bit_exact\n");
+    printf("%u,%u,%u,%zu,%.4f,%.4f,%zu,%.4f,%.4f,%.4f,%zu,%s\n", BODY_COUNT, PARTICLE_COUNT, simulation.getContactCount(), start.getSize(),
+        captureMs, restoreMs, deltaBytes / REPLAY_STEPS, deltaMs / REPLAY_STEPS, recordMs / REPLAY_STEPS, recordCpuMs / REPLAY_STEPS,
+        sessionBytes, exact ? "yes" : "no");
+
+    // On a single core the writer's work lands between the stepping thread's
+    // own, so only its CPU time says what record() costs a step
+    bool sharedCore = std::thread::hardware_concurrency() < 2;
+    bool inBudget = captureMs < FRAME_BUDGET_MS && recordCpuMs / REPLAY_STEPS < FRAME_BUDGET_MS &&
+        (sharedCore || recordMs / REPLAY_STEPS < FRAME_BUDGET_MS);
+    if (!inBudget) printf("Capture or record took %.1f ms or more per frame\n", FRAME_BUDGET_MS);
+
+    return exact && inBudget ? 0 : 1;
+}
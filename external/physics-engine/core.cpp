@@ -3,3 +3,15 @@
 const Vector3 Vector3::GRAVITY = Vector3(0, -9.81f, 0);
 const Vector3 Vector3::UP = Vector3(0, 1.0f, 0);
 const Vector3 Vector3::RIGHT = Vector3(1.0f, 0, 0);
+
+static float sleepEpsilon = 0.3f;
+
+void setSleepEpsilon(float value)
+{
+    sleepEpsilon = value;
+}
+
+float getSleepEpsilon()
+{
+    return sleepEpsilon;
+}
@@ -0,0 +1,98 @@
+#include "include/framearena.hpp"
+
+FrameArena::FrameArena(size_t blockSize) : current(0), offset(0), usedBefore(0), highWater(0), overflowCount(0)
+{
+    addBlock(blockSize);
+}
+
+FrameArena::~FrameArena()
+{
+    for (unsigned i = 0; i < blocks.size(); i++)
+    {
+        delete[] blocks[i].memory;
+    }
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+    size_t start = alignOffset(blocks[current].memory, offset, alignment);
+
+    if (start + size > blocks[current].size)
+    {
+        // Count the unused tail of the full block so the merged block on reset covers it
+        usedBefore += blocks[current].size;
+        overflowCount++;
+
+        addBlock(size + alignment);
+        current++;
+        start = alignOffset(blocks[current].memory, 0, alignment);
+    }
+
+    offset = start + size;
+
+    size_t used = getUsed();
+    if (used > highWater) highWater = used;
+
+    return blocks[current].memory + start;
+}
+
+void FrameArena::reset()
+{
+    // Replace several blocks with one that holds the whole frame
+    if (current > 0)
+    {
+        size_t total = 0;
+        for (unsigned i = 0; i < blocks.size(); i++)
+        {
+            total += blocks[i].size;
+            delete[] blocks[i].memory;
+        }
+        blocks.clear();
+        addBlock(total);
+    }
+
+    current = 0;
+    offset = 0;
+    usedBefore = 0;
+}
+
+size_t FrameArena::getUsed() const
+{
+    return usedBefore + offset;
+}
+
+size_t FrameArena::getHighWater() const
+{
+    return highWater;
+}
+
+size_t FrameArena::getCapacity() const
+{
+    size_t total = 0;
+    for (unsigned i = 0; i < blocks.size(); i++)
+    {
+        total += blocks[i].size;
+    }
+    return total;
+}
+
+unsigned FrameArena::getOverflowCount() const
+{
+    return overflowCount;
+}
+
+size_t FrameArena::alignOffset(const char* memory, size_t offset, size_t alignment)
+{
+    size_t address = (size_t)(memory + offset);
+    return offset + ((alignment - address % alignment) % alignment);
+}
+
+void FrameArena::addBlock(size_t minimumSize)
+{
+    // Grow geometrically so a rising workload settles after a few frames
+    size_t size = blocks.empty() ? minimumSize : blocks.back().size * 2;
+    if (size < minimumSize) size = minimumSize;
+
+    Block block = { new char[size], size };
+    blocks.push_back(block);
+}
@@ -1,18 +1,38 @@
 #include "include/groundcontact.hpp"
 
-void GroundContact::init(std::vector<Particle*> particles)
+GroundContact::GroundContact() : particles(NULL) {}
+
+void GroundContact::init(const std::vector<Particle*>& particles)
 {
-    GroundContact::particles = particles;
+    GroundContact::particles = &particles;
 }
 
 unsigned GroundContact::addContact(ParticleContact* contact, unsigned limit) const
+{
+    bool truncated;
+    return addContactChecked(contact, limit, &truncated);
+}
+
+unsigned GroundContact::addContactChecked(ParticleContact* contact, unsigned limit, bool* truncated) const
 {
     unsigned count = 0;
-    for (auto p = particles.begin(); p != particles.end(); p++)
+    *truncated = false;
+    if (!particles) return count;
+
+    for (auto p = particles->begin(); p != particles->end(); p++)
     {
+        // Sleeping particles rest where they are
+        if (!(*p)->getAwake()) continue;
+
         float y = (*p)->getPosition().y;
         if (y < 0.0f)
         {
+            if (count == limit)
+            {
+                *truncated = true;
+                return count;
+            }
+
             contact->contactNormal = Vector3::UP;
             contact->particle[0] = *p;
             contact->particle[1] = NULL;
@@ -21,8 +41,6 @@ unsigned GroundContact::addContact(ParticleContact* contact, unsigned limit) con
             contact++;
             count++;
         }
-
-        if (count >= limit) return count;
     }
     return count;
 }
\ No newline at end of file
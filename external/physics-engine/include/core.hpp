@@ -4,6 +4,11 @@
 #ifndef CORE_HPP // include guard
 #define CORE_HPP
 
+// Running-average motion below which bodies and particles fall asleep
+void setSleepEpsilon(float value);
+
+float getSleepEpsilon();
+
 class Vector3
 {
 public:
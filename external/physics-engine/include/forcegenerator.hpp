@@ -0,0 +1,16 @@
+#pragma once
+
+#ifndef FORCEGENERATOR_HPP // include guard
+#define FORCEGENERATOR_HPP
+
+#include "rigidbody.hpp"
+
+// Adds forces to a rigid body. A Simulation calls it at the start of every
+// fixed step, so a force lasts exactly one step however often frames run.
+class ForceGenerator
+{
+public:
+    virtual void updateForce(RigidBody* body, float duration) = 0;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#pragma once
+
+#ifndef FRAMEARENA_HPP // include guard
+#define FRAMEARENA_HPP
+
+#include <new>
+#include <stddef.h>
+#include <vector>
+
+// Bump allocator for memory that lives for one frame. Allocations are never
+// freed individually; reset() hands everything back at once. Requests that
+// don't fit the current block open a new one and count as an overflow, and
+// the next reset() merges the blocks so a steady workload stops allocating.
+class FrameArena
+{
+public:
+    explicit FrameArena(size_t blockSize = 64 * 1024);
+
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(max_align_t));
+
+    // Default-constructs count objects; their destructors are never run
+    template <typename T>
+    T* allocateArray(unsigned count)
+    {
+        T* objects = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        for (unsigned i = 0; i < count; i++)
+        {
+            new (objects + i) T();
+        }
+        return objects;
+    }
+
+    // Releases every allocation made since the last reset
+    void reset();
+
+    // Bytes handed out since the last reset
+    size_t getUsed() const;
+
+    // Most bytes handed out between two resets
+    size_t getHighWater() const;
+
+    size_t getCapacity() const;
+
+    // Allocations that had to open a new block
+    unsigned getOverflowCount() const;
+
+private:
+    struct Block
+    {
+        char* memory;
+
+        size_t size;
+    };
+
+    static size_t alignOffset(const char* memory, size_t offset, size_t alignment);
+
+    void addBlock(size_t minimumSize);
+
+    std::vector<Block> blocks;
+
+    // Block being allocated from and the offset into it
+    unsigned current;
+
+    size_t offset;
+
+    // Bytes in the blocks before the current one
+    size_t usedBefore;
+
+    size_t highWater;
+
+    unsigned overflowCount;
+};
+
+#endif
@@ -8,15 +8,21 @@
 #include "pcontact.hpp"
 #include "pcontactgenerator.hpp"
 
+// Pushes particles below y = 0 back up. The particle list is read on every
+// call rather than copied, so it must outlive the generator.
 class GroundContact : public ParticleContactGenerator
 {
 public:
-    void init(std::vector<Particle*> particles);
+    GroundContact();
+
+    void init(const std::vector<Particle*>& particles);
 
     virtual unsigned addContact(ParticleContact* contact, unsigned limit) const;
 
+    virtual unsigned addContactChecked(ParticleContact* contact, unsigned limit, bool* truncated) const;
+
 private:
-    std::vector<Particle*> particles;
+    const std::vector<Particle*>* particles;
 };
 
 #endif
\ No newline at end of file
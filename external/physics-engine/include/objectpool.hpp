@@ -0,0 +1,71 @@
+#pragma once
+
+#ifndef OBJECTPOOL_HPP // include guard
+#define OBJECTPOOL_HPP
+
+#include <vector>
+
+// Owns objects in fixed-size chunks so their addresses never move. Destroyed
+// slots go on a free list and are handed out again before a new chunk is made,
+// so creating and destroying at a steady rate stops allocating.
+template <typename T, unsigned CHUNK_SIZE = 256>
+class ObjectPool
+{
+public:
+    ObjectPool() : used(0) {}
+
+    ~ObjectPool()
+    {
+        for (unsigned i = 0; i < chunks.size(); i++)
+        {
+            delete[] chunks[i];
+        }
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    // Returns a default-constructed object
+    T* create()
+    {
+        if (!freeObjects.empty())
+        {
+            T* object = freeObjects.back();
+            freeObjects.pop_back();
+            *object = T();
+            return object;
+        }
+
+        if (used == chunks.size() * CHUNK_SIZE)
+        {
+            chunks.push_back(new T[CHUNK_SIZE]);
+        }
+
+        T* object = &chunks[used / CHUNK_SIZE][used % CHUNK_SIZE];
+        used++;
+        return object;
+    }
+
+    // object must have come from create() and not been destroyed since
+    void destroy(T* object)
+    {
+        freeObjects.push_back(object);
+    }
+
+    // Objects created and not destroyed
+    unsigned getCount() const
+    {
+        return used - (unsigned)freeObjects.size();
+    }
+
+private:
+    std::vector<T*> chunks;
+
+    // Slots handed out so far, destroyed ones included
+    unsigned used;
+
+    std::vector<T*> freeObjects;
+};
+
+#endif
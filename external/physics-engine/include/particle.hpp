@@ -9,6 +9,8 @@
 
 class Particle
 {
+    friend class ParticleWorld;
+
 protected:
     Vector3 position;
 
@@ -20,7 +22,15 @@ protected:
 
     float inverseMass;
 
+    bool isAwake;
+
+    bool canSleep;
+
+    float motion;
+
 public:
+    Particle() : damping(0), inverseMass(0), isAwake(true), canSleep(true), motion(getSleepEpsilon() * 2.0f) {}
+
     void setDamping(const float value)
     {
         damping = value;
@@ -112,10 +122,48 @@ public:
         return position;
     }
 
+    bool getAwake() const
+    {
+        return isAwake;
+    }
+
+    void setAwake(const bool awake = true)
+    {
+        if (awake)
+        {
+            isAwake = true;
+
+            // Give it a little motion so it doesn't fall straight back asleep
+            motion = getSleepEpsilon() * 2.0f;
+        }
+        else
+        {
+            isAwake = false;
+            velocity.clear();
+        }
+    }
+
+    bool getCanSleep() const
+    {
+        return canSleep;
+    }
+
+    void setCanSleep(const bool value)
+    {
+        canSleep = value;
+
+        if (!canSleep && !isAwake) setAwake();
+    }
+
+    float getMotion() const
+    {
+        return motion;
+    }
+
     void integrate(float deltaTime)
     {
-        // Skip integrating objects with infinite mass
-        if (inverseMass <= 0.0f) return;
+        // Skip integrating objects that are asleep or have infinite mass
+        if (!isAwake || inverseMass <= 0.0f) return;
 
         assert(deltaTime > 0.0f);
 
@@ -129,6 +177,29 @@ public:
 
         // Impose drag
         velocity *= powf(damping, deltaTime);
+
+        updateMotion(deltaTime);
+    }
+
+private:
+    void updateMotion(float deltaTime)
+    {
+        if (!canSleep) return;
+
+        // Recency-weighted average of squared speed
+        float currentMotion = velocity * velocity;
+        float bias = powf(0.5f, deltaTime);
+        motion = bias * motion + (1.0f - bias) * currentMotion;
+
+        if (motion < getSleepEpsilon())
+        {
+            setAwake(false);
+        }
+        else if (motion > 10.0f * getSleepEpsilon())
+        {
+            // Cap it so a fast object can settle in reasonable time
+            motion = 10.0f * getSleepEpsilon();
+        }
     }
 };
 
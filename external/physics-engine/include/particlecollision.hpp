@@ -0,0 +1,39 @@
+#pragma once
+
+#ifndef PARTICLECOLLISION_HPP // include guard
+#define PARTICLECOLLISION_HPP
+
+#include <vector>
+#include "particle.hpp"
+#include "pcontact.hpp"
+#include "pcontactgenerator.hpp"
+
+// Base for generators that collide particles with each other as spheres of a
+// shared radius. Subclasses supply the broadphase that finds candidate pairs.
+// The particle list is read on every call rather than copied, so particles
+// added to or removed from it later are seen; it must outlive the generator.
+class ParticleCollision : public ParticleContactGenerator
+{
+public:
+    ParticleCollision();
+
+    // radius must be positive; with any other radius no contacts are generated
+    virtual void init(const std::vector<Particle*>& particles, float radius, float restitution = 0.2f);
+
+    // Subclasses find contacts in addContactChecked, which reports truncation exactly
+    virtual unsigned addContact(ParticleContact* contact, unsigned limit) const;
+
+    virtual unsigned addContactChecked(ParticleContact* contact, unsigned limit, bool* truncated) const = 0;
+
+protected:
+    // Writes a contact for the pair if they overlap; returns whether one was written
+    bool addPairContact(ParticleContact* contact, Particle* a, Particle* b) const;
+
+    const std::vector<Particle*>* particles;
+
+    float radius;
+
+    float restitution;
+};
+
+#endif
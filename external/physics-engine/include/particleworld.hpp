@@ -0,0 +1,168 @@
+#pragma once
+
+#ifndef PARTICLEWORLD_HPP // include guard
+#define PARTICLEWORLD_HPP
+
+#include <map>
+#include <vector>
+#include "core.hpp"
+#include "particle.hpp"
+
+typedef unsigned ParticleHandle;
+
+// Stores particles as structure-of-arrays and integrates them in one batch.
+// Handles stay valid until the particle is removed, no matter how the dense
+// arrays are reordered. Contact generators and resolvers work on the Particle
+// view returned by getParticle(); from then on the view holds that particle's
+// state and integrate() steps it there, a view at a time with its vectors
+// loaded whole, while the lane-wide kernels run over the particles nobody has
+// asked a view for. Particles sleep as they do on
+// their own: sleeping ones are skipped until something wakes them.
+class ParticleWorld
+{
+public:
+    const static ParticleHandle INVALID_HANDLE;
+
+    ParticleWorld();
+
+    ~ParticleWorld();
+
+    ParticleWorld(const ParticleWorld&) = delete;
+
+    ParticleWorld& operator=(const ParticleWorld&) = delete;
+
+    ParticleHandle addParticle(const Particle& particle);
+
+    void removeParticle(ParticleHandle handle);
+
+    bool isValid(ParticleHandle handle) const;
+
+    unsigned getParticleCount() const;
+
+    // Returns a stable Particle for code that works on Particle pointers.
+    // Changes made through it are seen by the world and by integrate().
+    Particle* getParticle(ParticleHandle handle);
+
+    void setPosition(ParticleHandle handle, const Vector3& value);
+
+    Vector3 getPosition(ParticleHandle handle) const;
+
+    void setVelocity(ParticleHandle handle, const Vector3& value);
+
+    Vector3 getVelocity(ParticleHandle handle) const;
+
+    void setAcceleration(ParticleHandle handle, const Vector3& value);
+
+    Vector3 getAcceleration(ParticleHandle handle) const;
+
+    void setDamping(ParticleHandle handle, float value);
+
+    float getDamping(ParticleHandle handle) const;
+
+    void setInverseMass(ParticleHandle handle, float value);
+
+    float getInverseMass(ParticleHandle handle) const;
+
+    void setAwake(ParticleHandle handle, bool awake = true);
+
+    bool getAwake(ParticleHandle handle) const;
+
+    void setCanSleep(ParticleHandle handle, bool canSleep);
+
+    bool getCanSleep(ParticleHandle handle) const;
+
+    float getMotion(ParticleHandle handle) const;
+
+    // Integrates every awake particle with the widest available vector kernel
+    void integrate(float deltaTime);
+
+    // Same as integrate() without vector instructions
+    void integrateScalar(float deltaTime);
+
+private:
+    const static unsigned VIEW_CHUNK_SIZE = 256;
+
+    void pushView(unsigned index);
+
+    void swapParticles(unsigned a, unsigned b);
+
+    void updateDampingFactors(float deltaTime);
+
+    void setDampingClass(unsigned index, float value);
+
+    unsigned acquireDampingClass(float value);
+
+    void releaseDampingClass(unsigned dampingIndex);
+
+    void integrateViews(float deltaTime);
+
+    void integrateViewsScalar(float deltaTime);
+
+    void integrateRange(unsigned begin, unsigned end, float deltaTime);
+
+    Particle* viewSlot(ParticleHandle handle);
+
+    // Structure-of-arrays particle state, indexed densely
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> positionZ;
+
+    std::vector<float> velocityX;
+    std::vector<float> velocityY;
+    std::vector<float> velocityZ;
+
+    std::vector<float> accelerationX;
+    std::vector<float> accelerationY;
+    std::vector<float> accelerationZ;
+
+    std::vector<float> damping;
+
+    std::vector<float> inverseMass;
+
+    // 1 or 0, as floats so the kernels can mask with them
+    std::vector<float> awake;
+
+    std::vector<float> canSleep;
+
+    std::vector<float> motion;
+
+    // damping^deltaTime, refreshed only when the time step changes
+    std::vector<float> dampingFactor;
+
+    std::vector<unsigned> dampingClass;
+
+    // Distinct damping values in use, their factors for the cached time step
+    // and how many particles share each; unused classes are recycled
+    std::map<float, unsigned> dampingClasses;
+
+    std::vector<float> dampingValues;
+
+    std::vector<float> dampingValueFactors;
+
+    std::vector<unsigned> dampingReferences;
+
+    std::vector<unsigned> freeDampingClasses;
+
+    float factorDeltaTime;
+
+    // 0.5^deltaTime for the cached time step, weighting the motion average
+    float motionBias;
+
+    // Handle <-> dense index mapping
+    std::vector<unsigned> handleToIndex;
+
+    std::vector<ParticleHandle> indexToHandle;
+
+    std::vector<ParticleHandle> freeHandles;
+
+    // Particle views, allocated in fixed chunks so their addresses never move
+    std::vector<Particle*> viewChunks;
+
+    std::vector<Particle*> views;
+
+    // Particles with a view are kept at the front of the dense arrays, so
+    // the vector kernels start at viewCount
+    unsigned viewCount;
+};
+
+#endif
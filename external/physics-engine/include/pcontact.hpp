@@ -8,6 +8,7 @@
 class ParticleContact
 {
     friend class ParticleContactResolver;
+    friend class ParticleContactParallelResolver;
 
 public:
     Particle* particle[2];
@@ -25,6 +26,9 @@ protected:
 
     float calculateSeparatingVelocity() const;
 
+    // Adjusts penetration for the particle movement recorded by a resolved contact
+    void updatePenetration(const ParticleContact& resolved);
+
 private:
     void resolveVelocity(float duration);
 
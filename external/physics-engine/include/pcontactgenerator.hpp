@@ -8,7 +8,19 @@
 class ParticleContactGenerator
 {
 public:
+    virtual ~ParticleContactGenerator() {}
+
     virtual unsigned addContact(ParticleContact* contact, unsigned limit) const = 0;
+
+    // Same as addContact, and sets *truncated when there may have been more
+    // contacts than room for them, so the caller can grow the buffer and run
+    // it again. By default a full buffer counts as possibly truncated.
+    virtual unsigned addContactChecked(ParticleContact* contact, unsigned limit, bool* truncated) const
+    {
+        unsigned used = addContact(contact, limit);
+        *truncated = used == limit;
+        return used;
+    }
 };
 
 #endif
\ No newline at end of file
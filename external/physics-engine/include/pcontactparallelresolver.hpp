@@ -0,0 +1,71 @@
+#pragma once
+
+#ifndef PCONTACTPARALLELRESOLVER_HPP // include guard
+#define PCONTACTPARALLELRESOLVER_HPP
+
+#include <vector>
+#include "pcontact.hpp"
+#include "pcontactresolverbase.hpp"
+#include "threadpool.hpp"
+
+// Resolves contacts on a thread pool. Contacts are graph-coloured so that no
+// two contacts in a batch share a particle; a batch is resolved in parallel,
+// then every contact's penetration is updated before the next batch starts.
+// Batches never race, so results only depend on the contact order.
+class ParticleContactParallelResolver : public ParticleContactResolverBase
+{
+protected:
+    unsigned iterations;
+
+    unsigned iterationsUsed;
+
+public:
+    // threadCount includes the calling thread
+    ParticleContactParallelResolver(unsigned iterations, unsigned threadCount);
+
+    virtual void setIterations(unsigned iterations);
+
+    virtual unsigned getIterationsUsed() const;
+
+    unsigned getBatchCount() const;
+
+    // Every eligible contact of a batch is resolved, so the last batch may
+    // overrun the iteration budget by up to its size
+    virtual void resolveContacts(ParticleContact* contactArray, unsigned numContacts, float duration);
+
+private:
+    const static unsigned NO_CONTACT = 0xFFFFFFFFu;
+
+    const static unsigned GRAIN_SIZE = 256;
+
+    void buildParticleIndices(ParticleContact* contactArray, unsigned numContacts);
+
+    void colourContacts(unsigned numContacts);
+
+    unsigned resolveBatch(ParticleContact* contactArray, unsigned batch, float duration);
+
+    void updatePenetrations(ParticleContact* contactArray, unsigned numContacts, unsigned batch);
+
+    ThreadPool pool;
+
+    // Scratch storage reused between calls to avoid per-frame allocations
+    std::vector<const Particle*> particles;
+
+    std::vector<unsigned> contactParticles;
+
+    std::vector<unsigned long long> particleColours;
+
+    std::vector<unsigned> particleOverflow;
+
+    std::vector<unsigned> contactColour;
+
+    std::vector<unsigned> batchStart;
+
+    std::vector<unsigned> batchContacts;
+
+    std::vector<unsigned> movedBy;
+
+    std::vector<unsigned> chunkResolved;
+};
+
+#endif
@@ -3,21 +3,80 @@
 #ifndef PCONTACTRESOLVER_HPP // include guard
 #define PCONTACTRESOLVER_HPP
 
+#include <vector>
 #include "pcontact.hpp"
+#include "pcontactresolverbase.hpp"
 
-class ParticleContactResolver
+class ParticleContactResolver : public ParticleContactResolverBase
 {
+public:
+    enum Strategy
+    {
+        // Rescan every contact on every iteration
+        LINEAR_SCAN,
+
+        // Keep contacts in an indexed min-heap and only rescore contacts that
+        // share a particle with the one just resolved
+        PRIORITY_QUEUE
+    };
+
 protected:
     unsigned iterations;
 
     unsigned iterationsUsed;
 
+    Strategy strategy;
+
 public:
-    ParticleContactResolver(unsigned iterations);
+    ParticleContactResolver(unsigned iterations, Strategy strategy = LINEAR_SCAN);
+
+    virtual void setIterations(unsigned iterations);
+
+    void setStrategy(Strategy strategy);
+
+    virtual unsigned getIterationsUsed() const;
+
+    virtual void resolveContacts(ParticleContact* contactArray, unsigned numContacts, float duration);
+
+private:
+    struct ParticleContactRef
+    {
+        const Particle* particle;
+
+        unsigned contact;
+
+        bool operator<(const ParticleContactRef& other) const;
+    };
+
+    void resolveContactsLinear(ParticleContact* contactArray, unsigned numContacts, float duration);
+
+    void resolveContactsPriority(ParticleContact* contactArray, unsigned numContacts, float duration);
+
+    // Resolves a contact and records exactly how far it moved its particles
+    void resolveAndTrack(ParticleContact& contact, float duration);
+
+    float priorityOf(const ParticleContact& contact) const;
+
+    bool heapLess(unsigned a, unsigned b) const;
+
+    void heapSwap(unsigned a, unsigned b);
+
+    void heapSiftUp(unsigned position);
+
+    void heapSiftDown(unsigned position);
+
+    void heapUpdate(ParticleContact* contactArray, unsigned contact);
+
+    // Scratch storage reused between calls to avoid per-frame allocations
+    std::vector<unsigned> heap;
+
+    std::vector<unsigned> heapPosition;
+
+    std::vector<float> priority;
 
-    void setIterations(unsigned iterations);
+    std::vector<ParticleContactRef> particleContacts;
 
-    void resolveContacts(ParticleContact* contactArray, unsigned numContacts, float duration);
+    std::vector<unsigned> affected;
 };
 
 #endif
\ No newline at end of file
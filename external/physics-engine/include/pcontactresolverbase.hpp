@@ -0,0 +1,22 @@
+#pragma once
+
+#ifndef PCONTACTRESOLVERBASE_HPP // include guard
+#define PCONTACTRESOLVERBASE_HPP
+
+#include "pcontact.hpp"
+
+// What a Simulation needs from a contact resolver, so the serial and the
+// parallel resolver can be swapped for each other
+class ParticleContactResolverBase
+{
+public:
+    virtual ~ParticleContactResolverBase() {}
+
+    virtual void setIterations(unsigned iterations) = 0;
+
+    virtual unsigned getIterationsUsed() const = 0;
+
+    virtual void resolveContacts(ParticleContact* contactArray, unsigned numContacts, float duration) = 0;
+};
+
+#endif
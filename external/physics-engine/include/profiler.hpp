@@ -0,0 +1,221 @@
+#pragma once
+
+#ifndef PROFILER_HPP // include guard
+#define PROFILER_HPP
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Frame profiler. Zones and counters are written to a ring buffer owned by
+// the recording thread, with no locks; endFrame() drains every buffer, adds
+// the frame to a rolling per-name window and keeps recent events for a
+// Chrome trace (chrome://tracing or ui.perfetto.dev). A thread's buffer is
+// freed by the first endFrame() or clear() after the thread exits. Building
+// without PHYSICS_PROFILER turns the macros below into nothing.
+class Profiler
+{
+public:
+    struct Stats
+    {
+        std::string name;
+
+        // Counters hold recorded values; zones hold milliseconds per frame
+        bool counter;
+
+        unsigned frames;
+
+        double min;
+
+        double avg;
+
+        double p99;
+
+        double max;
+    };
+
+    static Profiler& get();
+
+    Profiler(const Profiler&) = delete;
+
+    Profiler& operator=(const Profiler&) = delete;
+
+    static uint64_t now();
+
+    // name must outlive the profiler, a string literal in practice
+    void recordZone(const char* name, uint64_t start, uint64_t end);
+
+    void recordCounter(const char* name, double value);
+
+    // Drains every thread's events and closes the current frame
+    void endFrame();
+
+    // Frames kept for the rolling statistics
+    void setWindowSize(unsigned frames);
+
+    // Events kept for the trace; the oldest are dropped first
+    void setTraceCapacity(unsigned events);
+
+    void getSummary(std::vector<Stats>& stats) const;
+
+    void printSummary(FILE* file) const;
+
+    bool writeChromeTrace(const char* path) const;
+
+    // Events lost because a thread's ring buffer was full
+    unsigned long getDroppedCount() const;
+
+    // Ring buffers held, one per recording thread not yet reclaimed
+    unsigned getBufferCount() const;
+
+    // Forgets all statistics and trace events
+    void clear();
+
+private:
+    enum EventType
+    {
+        ZONE,
+        COUNTER
+    };
+
+    struct Event
+    {
+        const char* name;
+
+        EventType type;
+
+        // Zones use start and end; counters use start and value
+        uint64_t start;
+
+        uint64_t end;
+
+        double value;
+    };
+
+    struct TraceEvent
+    {
+        Event event;
+
+        unsigned thread;
+    };
+
+    // Single-producer, single-consumer queue; only its thread writes to it
+    struct ThreadBuffer
+    {
+        const static unsigned CAPACITY = 1 << 14;
+
+        Event events[CAPACITY];
+
+        std::atomic<unsigned> head;
+
+        std::atomic<unsigned> tail;
+
+        std::atomic<unsigned long> dropped;
+
+        // Set when the owning thread exits; the buffer is freed once drained
+        std::atomic<bool> retired;
+
+        unsigned thread;
+    };
+
+    // Lives in thread-local storage and retires the thread's buffer on exit
+    struct ThreadOwner
+    {
+        ThreadBuffer* buffer;
+
+        ~ThreadOwner();
+    };
+
+    // Per-frame totals for one name, oldest overwritten first
+    struct Series
+    {
+        bool counter;
+
+        std::vector<double> samples;
+
+        unsigned next;
+
+        unsigned count;
+
+        double frameValue;
+
+        bool touched;
+    };
+
+    Profiler();
+
+    ~Profiler();
+
+    ThreadBuffer* threadBuffer();
+
+    void push(const Event& event);
+
+    void drain(ThreadBuffer* buffer);
+
+    // Drains every buffer, or throws the events away, and frees the buffers of exited threads
+    void drainAll(bool discard);
+
+    Series* findSeries(const char* name, bool counter);
+
+    mutable std::mutex mutex;
+
+    std::vector<ThreadBuffer*> buffers;
+
+    // Trace ids stay unique after buffers are freed
+    unsigned nextThread;
+
+    // Dropped counts of freed buffers
+    unsigned long retiredDropped;
+
+    // Series by name, plus a lookup by name pointer so draining doesn't build strings
+    std::map<std::string, Series> series;
+
+    std::map<const char*, Series*> seriesByPointer;
+
+    unsigned windowSize;
+
+    std::vector<TraceEvent> trace;
+
+    unsigned traceCapacity;
+
+    unsigned traceNext;
+};
+
+// Times the enclosing scope
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char* name) : name(name), start(Profiler::now()) {}
+
+    ~ProfileZone()
+    {
+        Profiler::get().recordZone(name, start, Profiler::now());
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+
+    uint64_t start;
+};
+
+#ifdef PHYSICS_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_COUNTER(name, value) Profiler::get().recordCounter(name, (double)(value))
+#define PROFILE_FRAME() Profiler::get().endFrame()
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#endif
+
+#endif
@@ -9,6 +9,10 @@
 
 class RigidBody
 {
+    friend class RigidBodyWorld;
+
+    friend class Snapshot;
+
 protected:
     Vector3 position;
 
@@ -38,7 +42,15 @@ protected:
 
     Vector3 lastFrameAcceleration;
 
+    bool isAwake;
+
+    bool canSleep;
+
+    float motion;
+
 public:
+    RigidBody() : inverseMass(0), linearDamping(0), angularDamping(0), isAwake(true), canSleep(true), motion(getSleepEpsilon() * 2.0f) {}
+
     void setLinearDamping(const float value)
     {
         linearDamping = value;
@@ -142,6 +154,9 @@ public:
 
     void integrate(float deltaTime)
     {
+        // Sleeping bodies don't move until something wakes them
+        if (!isAwake) return;
+
         // Calculate linear acceleration
         lastFrameAcceleration = acceleration;
         lastFrameAcceleration.addScaledVector(forceAccum, inverseMass);
@@ -170,6 +185,47 @@ public:
 
         // Clean up
         clearAccumulators();
+
+        updateMotion(deltaTime);
+    }
+
+    bool getAwake() const
+    {
+        return isAwake;
+    }
+
+    void setAwake(const bool awake = true)
+    {
+        if (awake)
+        {
+            isAwake = true;
+
+            // Give it a little motion so it doesn't fall straight back asleep
+            motion = getSleepEpsilon() * 2.0f;
+        }
+        else
+        {
+            isAwake = false;
+            velocity.clear();
+            angularVelocity.clear();
+        }
+    }
+
+    bool getCanSleep() const
+    {
+        return canSleep;
+    }
+
+    void setCanSleep(const bool value)
+    {
+        canSleep = value;
+
+        if (!canSleep && !isAwake) setAwake();
+    }
+
+    float getMotion() const
+    {
+        return motion;
     }
 
     void setOrientation(const Quaternion& value)
@@ -263,11 +319,13 @@ public:
     void addForce(const Vector3& force)
     {
         forceAccum += force;
+        setAwake();
     }
 
     void addTorque(const Vector3& torque)
     {
         torqueAccum += torque;
+        setAwake();
     }
 
     void clearAccumulators()
@@ -283,6 +341,7 @@ public:
 
         forceAccum += force;
         torqueAccum += Vector3::cross(pt, force);
+        setAwake();
     }
 
     void addForceAtBodyPoint(const Vector3& force, const Vector3& point)
@@ -307,6 +366,26 @@ public:
     }
 
 private:
+    void updateMotion(float deltaTime)
+    {
+        if (!canSleep) return;
+
+        // Recency-weighted average of squared linear and angular speed
+        float currentMotion = velocity * velocity + angularVelocity * angularVelocity;
+        float bias = powf(0.5f, deltaTime);
+        motion = bias * motion + (1.0f - bias) * currentMotion;
+
+        if (motion < getSleepEpsilon())
+        {
+            setAwake(false);
+        }
+        else if (motion > 10.0f * getSleepEpsilon())
+        {
+            // Cap it so a fast body can settle in reasonable time
+            motion = 10.0f * getSleepEpsilon();
+        }
+    }
+
     void _calculateTransformMatrix(Matrix3x4& transformMatrix, const Vector3& position, const Quaternion& orientation)
     {
         transformMatrix.data[0] = 1.0f - 2.0f * orientation.y * orientation.y - 2.0f * orientation.z * orientation.z;
@@ -0,0 +1,157 @@
+#pragma once
+
+#ifndef RIGIDBODYWORLD_HPP // include guard
+#define RIGIDBODYWORLD_HPP
+
+#include <vector>
+#include "core.hpp"
+#include "rigidbody.hpp"
+
+typedef unsigned RigidBodyHandle;
+
+// Stores rigid bodies as structure-of-arrays so integration and the derived
+// transform and world inertia tensor are computed 4 or 8 bodies at a time.
+// Bodies are grouped in blocks of LANES that hold every field of those bodies,
+// one field after another, so a step walks memory once front to back instead
+// of streaming from one array per field. Follows RigidBody::integrate step for
+// step, sleep included: a block with nobody awake is skipped and sleeping
+// lanes of the others are left as they are. Handles stay valid until the
+// body is removed.
+class RigidBodyWorld
+{
+public:
+    const static RigidBodyHandle INVALID_HANDLE;
+
+    // Bodies per block
+    const static unsigned LANES = 8;
+
+    // One scalar of body state, stored LANES wide in each block
+    enum Field
+    {
+        POSITION_X, POSITION_Y, POSITION_Z,
+        ORIENTATION_X, ORIENTATION_Y, ORIENTATION_Z, ORIENTATION_W,
+        VELOCITY_X, VELOCITY_Y, VELOCITY_Z,
+        ACCELERATION_X, ACCELERATION_Y, ACCELERATION_Z,
+        ANGULAR_VELOCITY_X, ANGULAR_VELOCITY_Y, ANGULAR_VELOCITY_Z,
+        FORCE_X, FORCE_Y, FORCE_Z,
+        TORQUE_X, TORQUE_Y, TORQUE_Z,
+        LAST_FRAME_ACCELERATION_X, LAST_FRAME_ACCELERATION_Y, LAST_FRAME_ACCELERATION_Z,
+        INVERSE_MASS,
+        LINEAR_DAMPING,
+        ANGULAR_DAMPING,
+        // damping^deltaTime for the cached time step
+        LINEAR_DAMPING_FACTOR,
+        ANGULAR_DAMPING_FACTOR,
+        // 1 or 0, as floats so the kernels can mask with them
+        AWAKE,
+        CAN_SLEEP,
+        MOTION,
+        // Row-major, as in Matrix3x3 and Matrix3x4
+        INVERSE_INERTIA_TENSOR,
+        INVERSE_INERTIA_TENSOR_WORLD = INVERSE_INERTIA_TENSOR + 9,
+        TRANSFORM = INVERSE_INERTIA_TENSOR_WORLD + 9,
+        FIELD_COUNT = TRANSFORM + 12
+    };
+
+    RigidBodyWorld();
+
+    RigidBodyHandle addBody(const RigidBody& body);
+
+    void removeBody(RigidBodyHandle handle);
+
+    bool isValid(RigidBodyHandle handle) const;
+
+    unsigned getBodyCount() const;
+
+    // Copies the full state of a body, derived data included, into a RigidBody
+    void getBody(RigidBodyHandle handle, RigidBody* body) const;
+
+    void setPosition(RigidBodyHandle handle, const Vector3& value);
+
+    Vector3 getPosition(RigidBodyHandle handle) const;
+
+    void setOrientation(RigidBodyHandle handle, const Quaternion& value);
+
+    Quaternion getOrientation(RigidBodyHandle handle) const;
+
+    void setVelocity(RigidBodyHandle handle, const Vector3& value);
+
+    Vector3 getVelocity(RigidBodyHandle handle) const;
+
+    void setAngularVelocity(RigidBodyHandle handle, const Vector3& value);
+
+    Vector3 getAngularVelocity(RigidBodyHandle handle) const;
+
+    void setAcceleration(RigidBodyHandle handle, const Vector3& value);
+
+    void setDamping(RigidBodyHandle handle, float linearDamping, float angularDamping);
+
+    void setInverseMass(RigidBodyHandle handle, float value);
+
+    void setInverseInertiaTensor(RigidBodyHandle handle, const Matrix3x3& value);
+
+    void setAwake(RigidBodyHandle handle, bool awake = true);
+
+    bool getAwake(RigidBodyHandle handle) const;
+
+    void setCanSleep(RigidBodyHandle handle, bool canSleep);
+
+    bool getCanSleep(RigidBodyHandle handle) const;
+
+    float getMotion(RigidBodyHandle handle) const;
+
+    Matrix3x4 getTransform(RigidBodyHandle handle) const;
+
+    Matrix3x3 getInverseInertiaTensorWorld(RigidBodyHandle handle) const;
+
+    void addForce(RigidBodyHandle handle, const Vector3& force);
+
+    void addTorque(RigidBodyHandle handle, const Vector3& torque);
+
+    void addForceAtPoint(RigidBodyHandle handle, const Vector3& force, const Vector3& point);
+
+    // Integrates every awake body and rebuilds its derived data. Adding a
+    // force or torque wakes a body, as it does a RigidBody.
+    void integrate(float deltaTime);
+
+    // Same as integrate() without vector instructions
+    void integrateScalar(float deltaTime);
+
+    // Rebuilds every transform and world inverse inertia tensor from the current state
+    void calculateDerivedData();
+
+    // Reads any one field of a body
+    float getValue(RigidBodyHandle handle, Field field) const;
+
+private:
+    const static unsigned BLOCK_SIZE = FIELD_COUNT * LANES;
+
+    void updateDampingFactors(float deltaTime);
+
+    // Start of the block holding the body at a dense index
+    float* block(unsigned index);
+
+    float& slot(unsigned index, unsigned field);
+
+    float slot(unsigned index, unsigned field) const;
+
+    Vector3 getVector(unsigned index, Field x) const;
+
+    void setVector(unsigned index, Field x, const Vector3& value);
+
+    std::vector<float> blocks;
+
+    float factorDeltaTime;
+
+    // 0.5^deltaTime for the cached time step, weighting the motion average
+    float motionBias;
+
+    // Handle <-> dense index mapping
+    std::vector<unsigned> handleToIndex;
+
+    std::vector<RigidBodyHandle> indexToHandle;
+
+    std::vector<RigidBodyHandle> freeHandles;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#ifndef SIMD_HPP // include guard
+#define SIMD_HPP
+
+// Selects the widest vector instruction set available to the batch kernels.
+// Define PHYSICS_NO_SIMD to force the scalar fallbacks.
+#if !defined(PHYSICS_NO_SIMD)
+#if defined(__AVX__)
+#define PHYSICS_SIMD_AVX 1
+#define PHYSICS_SIMD_SSE 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PHYSICS_SIMD_SSE 1
+#endif
+#endif
+
+#if defined(PHYSICS_SIMD_AVX)
+#include <immintrin.h>
+#elif defined(PHYSICS_SIMD_SSE)
+#include <emmintrin.h>
+#endif
+
+#endif
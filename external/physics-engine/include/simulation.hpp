@@ -0,0 +1,164 @@
+#pragma once
+
+#ifndef SIMULATION_HPP // include guard
+#define SIMULATION_HPP
+
+#include <vector>
+#include "core.hpp"
+#include "forcegenerator.hpp"
+#include "framearena.hpp"
+#include "objectpool.hpp"
+#include "particle.hpp"
+#include "pcontact.hpp"
+#include "pcontactgenerator.hpp"
+#include "pcontactresolver.hpp"
+#include "pcontactresolverbase.hpp"
+#include "rigidbody.hpp"
+
+// Steps rigid bodies, particles and particle contacts at a fixed time step.
+// advance() feeds it wall-clock time; the fraction of a step left over is
+// exposed so a renderer can interpolate between the last two steps. Input
+// belongs in a force generator, which runs once per step rather than once per
+// frame. Needs no window or clock, so it runs as fast as the CPU allows when
+// driven headless.
+// Contacts live in a frame arena and the buffer grows when generators fill it,
+// so once the scene settles a step makes no heap allocations.
+class Simulation
+{
+    friend class Snapshot;
+
+public:
+    Simulation(float timeStep, unsigned initialContacts, unsigned maxStepsPerAdvance = 8);
+
+    Simulation(const Simulation&) = delete;
+
+    Simulation& operator=(const Simulation&) = delete;
+
+    // Returns the index used to query interpolated state for the body
+    unsigned addRigidBody(RigidBody* body);
+
+    // Same as addRigidBody() for a body owned by the simulation
+    unsigned createRigidBody();
+
+    RigidBody* getRigidBody(unsigned body);
+
+    void addParticle(Particle* particle);
+
+    // Adds a particle owned by the simulation
+    Particle* createParticle();
+
+    // Removes a particle made by createParticle() and frees its slot for the
+    // next one. Particles after it move down one index, and the latest step's
+    // contacts are dropped.
+    void destroyParticle(Particle* particle);
+
+    void addContactGenerator(ParticleContactGenerator* generator);
+
+    // Runs the generator on the body at the start of every step
+    void addForceGenerator(unsigned body, ForceGenerator* generator);
+
+    const std::vector<Particle*>& getParticles() const;
+
+    // Runs as many fixed steps as the accumulated time allows and returns how many ran
+    unsigned advance(float elapsed);
+
+    // Runs exactly one fixed step
+    void step();
+
+    float getTimeStep() const;
+
+    unsigned getStepCount() const;
+
+    unsigned getContactCount() const;
+
+    // Contacts from the latest step, valid until the next one
+    const ParticleContact* getContacts() const;
+
+    unsigned getContactCapacity() const;
+
+    // Most contacts generated in one step
+    unsigned getContactHighWater() const;
+
+    // Steps whose contacts outgrew the buffer and had to be regenerated
+    unsigned getContactOverflowCount() const;
+
+    const FrameArena& getArena() const;
+
+    // The built-in serial resolver, used unless setResolver() picks another
+    ParticleContactResolver& getResolver();
+
+    // Resolves contacts with the given resolver, such as a
+    // ParticleContactParallelResolver, which the caller keeps ownership of;
+    // NULL goes back to the built-in one
+    void setResolver(ParticleContactResolverBase* contactResolver);
+
+    // Fraction of a step between the previous and current state to render
+    float getInterpolationAlpha() const;
+
+    Vector3 getInterpolatedPosition(unsigned body) const;
+
+    Matrix3x4 getInterpolatedTransform(unsigned body) const;
+
+private:
+    struct ForceRegistration
+    {
+        unsigned body;
+
+        ForceGenerator* generator;
+    };
+
+    void updateForces();
+
+    void integrate();
+
+    unsigned generateContacts();
+
+    void growContacts(unsigned count);
+
+    float timeStep;
+
+    float accumulator;
+
+    unsigned maxStepsPerAdvance;
+
+    unsigned stepCount;
+
+    std::vector<RigidBody*> bodies;
+
+    // Body state at the start of the latest step
+    std::vector<Vector3> previousPositions;
+
+    std::vector<Quaternion> previousOrientations;
+
+    std::vector<Particle*> particles;
+
+    // Bumped whenever the particle list changes, so lookups built from it know to rebuild
+    unsigned particleListVersion;
+
+    std::vector<ParticleContactGenerator*> contactGenerators;
+
+    std::vector<ForceRegistration> forceRegistrations;
+
+    ObjectPool<RigidBody> rigidBodyPool;
+
+    ObjectPool<Particle> particlePool;
+
+    // Reset at the start of every step
+    FrameArena arena;
+
+    ParticleContact* contacts;
+
+    unsigned contactCapacity;
+
+    unsigned usedContacts;
+
+    unsigned contactHighWater;
+
+    unsigned contactOverflowCount;
+
+    ParticleContactResolver resolver;
+
+    ParticleContactResolverBase* activeResolver;
+};
+
+#endif
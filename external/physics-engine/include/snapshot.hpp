@@ -0,0 +1,132 @@
+#pragma once
+
+#ifndef SNAPSHOT_HPP // include guard
+#define SNAPSHOT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "particle.hpp"
+#include "simulation.hpp"
+
+// Binary image of a Simulation: its particles, rigid bodies (state,
+// accumulators and derived matrices) and the latest step's contacts. Objects
+// are copied whole in their in-memory layout, so capture and restore are a
+// memcpy per object; the header records the layout sizes and a snapshot from
+// a build with a different layout is rejected. restore() needs a simulation
+// built with the same bodies and particles in the same order. The global
+// sleep epsilon is captured and restored with it.
+//
+// Only state the Simulation owns is captured. ParticleWorld and RigidBodyWorld
+// keep their own arrays and are not part of a snapshot, and contact generators
+// are expected to be stateless or, like SweepPruneContact, to derive their
+// state from the particle positions.
+class Snapshot
+{
+public:
+    const static uint32_t MAGIC;
+
+    const static uint32_t VERSION;
+
+    Snapshot();
+
+    void capture(const Simulation& simulation);
+
+    // Returns false, leaving the simulation untouched, if the snapshot doesn't fit it
+    bool restore(Simulation& simulation) const;
+
+    const unsigned char* getData() const;
+
+    size_t getSize() const;
+
+    // Takes a copy of a snapshot written by getData(); returns false if the header is invalid
+    bool setData(const unsigned char* data, size_t size);
+
+    // Exchanges contents without copying, for double buffering
+    void swap(Snapshot& other);
+
+    // Writes the changes from previous to this snapshot: the XOR of the two with
+    // the zero halves of each word left out, so bodies that didn't move cost
+    // almost nothing and ones that moved a little cost less than whole
+    void encodeDelta(const Snapshot& previous, std::vector<unsigned char>& delta) const;
+
+    // Turns this snapshot into the one a delta from it was encoded against
+    bool applyDelta(const unsigned char* delta, size_t size);
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+
+        uint32_t version;
+
+        // Layout check
+        uint32_t particleSize;
+
+        uint32_t bodySize;
+
+        uint32_t contactSize;
+
+        uint32_t particleCount;
+
+        uint32_t bodyCount;
+
+        uint32_t contactCount;
+
+        uint32_t stepCount;
+
+        float timeStep;
+
+        float accumulator;
+
+        float sleepEpsilon;
+    };
+
+    // A ParticleContact with its particles stored as indices
+    struct ContactRecord
+    {
+        int32_t particle[2];
+
+        float restitution;
+
+        Vector3 contactNormal;
+
+        float penetration;
+
+        Vector3 particleMovement[2];
+    };
+
+    struct ParticleIndex
+    {
+        const Particle* particle;
+
+        unsigned index;
+
+        bool operator<(const ParticleIndex& other) const;
+    };
+
+    // Byte offset of the first body record
+    static size_t bodiesOffset(const Header& h);
+
+    static size_t expectedSize(const Header& h);
+
+    // The words a delta XORs a block with: the base's own, zeros past its end
+    // and, with a predicted layout, predictions for the state at the start of the last step
+    static void expectedWords(const unsigned char* base, size_t baseWords, const Header* predicted, size_t first, size_t count, uint32_t* out);
+
+    // The header if the data is a complete snapshot from this build, otherwise NULL
+    const Header* header() const;
+
+    int32_t findParticle(const Simulation& simulation, const Particle* particle);
+
+    std::vector<unsigned char> data;
+
+    // Particle pointer to index lookup, rebuilt when the simulation's particles change
+    std::vector<ParticleIndex> particleIndices;
+
+    const Simulation* indexedSimulation;
+
+    unsigned indexedVersion;
+};
+
+#endif
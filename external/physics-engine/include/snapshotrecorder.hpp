@@ -0,0 +1,168 @@
+#pragma once
+
+#ifndef SNAPSHOTRECORDER_HPP // include guard
+#define SNAPSHOTRECORDER_HPP
+
+#include <condition_variable>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+#include "snapshot.hpp"
+
+// Memory-mapped file shared by the recorder and the reader
+class MappedFile
+{
+public:
+    MappedFile();
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Creates or truncates the file and maps capacity bytes of it for writing
+    bool create(const char* path, size_t capacity);
+
+    // Maps an existing file read-only
+    bool openRead(const char* path);
+
+    // Remaps a writable file at a larger size
+    bool grow(size_t capacity);
+
+    // Unmaps, trimming a writable file to size bytes
+    void close(size_t size);
+
+    unsigned char* getData() const;
+
+    size_t getCapacity() const;
+
+private:
+    bool map(bool writable);
+
+    void unmap();
+
+    unsigned char* data;
+
+    size_t capacity;
+
+    bool writable;
+
+#ifdef _WIN32
+    void* file;
+
+    void* mapping;
+#else
+    int file;
+#endif
+};
+
+// Streams a session of snapshots to a memory-mapped file: a full snapshot
+// every keyframe interval and deltas against the previous frame in between,
+// so a replay can start from any keyframe. record() only captures; a writer
+// thread encodes and appends the frame, so a step pays for the capture alone.
+class SnapshotRecorder
+{
+public:
+    const static uint32_t MAGIC;
+
+    const static uint32_t VERSION;
+
+    SnapshotRecorder();
+
+    ~SnapshotRecorder();
+
+    bool open(const char* path, unsigned keyframeInterval = 60, size_t initialCapacity = 16 << 20);
+
+    // Captures the simulation and queues it for the writer, waiting only if
+    // the writer is still on the frame before. Returns false when the recorder
+    // isn't open or an earlier frame failed to write.
+    bool record(const Simulation& simulation);
+
+    // Waits until every recorded frame is in the file; false if any failed
+    bool flush();
+
+    // The frame passed to the last record(), once it has been written
+    const Snapshot& getLastFrame();
+
+    // Writes the queued frames and trims the file to the recorded size; also
+    // done by the destructor
+    void close();
+
+    // Frames written so far, waiting for queued ones
+    unsigned getFrameCount();
+
+    // Bytes written to the file so far, waiting for queued frames
+    size_t getSize();
+
+private:
+    void writerLoop();
+
+    // Encodes and appends the writing frame, which then becomes previous
+    bool write();
+
+    bool append(uint32_t type, const unsigned char* payload, size_t size);
+
+    // Owned by the writer thread while it runs
+    MappedFile file;
+
+    size_t size;
+
+    unsigned keyframeInterval;
+
+    unsigned frameCount;
+
+    // The writer's frame, and the last one it wrote, which deltas are against
+    Snapshot writing;
+
+    Snapshot previous;
+
+    std::vector<unsigned char> delta;
+
+    // Filled by record() on the caller's thread, then swapped with pending
+    Snapshot captured;
+
+    // Guarded by mutex: a frame waiting for the writer, and the writer's state
+    Snapshot pending;
+
+    bool hasPending;
+
+    bool busy;
+
+    bool failed;
+
+    bool stopping;
+
+    std::mutex mutex;
+
+    std::condition_variable changed;
+
+    std::thread writer;
+};
+
+// Plays back a file written by SnapshotRecorder one frame at a time
+class SnapshotReader
+{
+public:
+    SnapshotReader();
+
+    bool open(const char* path);
+
+    void close();
+
+    // Rebuilds the next recorded frame into snapshot; false at the end or on a corrupt record
+    bool next(Snapshot& snapshot);
+
+private:
+    MappedFile file;
+
+    size_t size;
+
+    size_t offset;
+
+    Snapshot current;
+};
+
+#endif
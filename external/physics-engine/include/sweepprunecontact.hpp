@@ -0,0 +1,31 @@
+#pragma once
+
+#ifndef SWEEPPRUNECONTACT_HPP // include guard
+#define SWEEPPRUNECONTACT_HPP
+
+#include <vector>
+#include "particlecollision.hpp"
+
+// Sorts particles along the x axis and only tests pairs whose extents overlap
+// on it. The order is kept between calls, so the insertion sort that repairs it
+// is close to linear while particles move coherently. Ties on x are broken by
+// particle index, so the order is a function of the positions alone.
+class SweepPruneContact : public ParticleCollision
+{
+public:
+    virtual void init(const std::vector<Particle*>& particles, float radius, float restitution = 0.2f);
+
+    virtual unsigned addContactChecked(ParticleContact* contact, unsigned limit, bool* truncated) const;
+
+private:
+    void resetAxis() const;
+
+    void sortAxis() const;
+
+    // Particle indices sorted by x, and the x each was sorted with
+    mutable std::vector<unsigned> order;
+
+    mutable std::vector<float> keys;
+};
+
+#endif
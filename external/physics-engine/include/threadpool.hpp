@@ -0,0 +1,71 @@
+#pragma once
+
+#ifndef THREADPOOL_HPP // include guard
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads with one task queue each. Idle workers steal
+// from the front of other queues; the calling thread helps until a job is done.
+class ThreadPool
+{
+public:
+    typedef std::function<void(unsigned begin, unsigned end)> RangeTask;
+
+    // threadCount includes the calling thread, so 1 runs everything inline
+    explicit ThreadPool(unsigned threadCount);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned getThreadCount() const;
+
+    // Calls task over [0, count) in chunks of at most grainSize and blocks until all have run
+    void parallelFor(unsigned count, unsigned grainSize, const RangeTask& task);
+
+private:
+    struct Range
+    {
+        unsigned begin;
+
+        unsigned end;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+
+        std::deque<Range> ranges;
+    };
+
+    void workerLoop(unsigned index);
+
+    bool runOne(unsigned index);
+
+    std::vector<std::thread> workers;
+
+    std::vector<Queue*> queues;
+
+    const RangeTask* job;
+
+    std::atomic<unsigned> remaining;
+
+    std::mutex wakeMutex;
+
+    std::condition_variable wake;
+
+    unsigned generation;
+
+    bool stopping;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+
+#ifndef UNIFORMGRIDCONTACT_HPP // include guard
+#define UNIFORMGRIDCONTACT_HPP
+
+#include <vector>
+#include "particlecollision.hpp"
+
+// Bins particles into a uniform grid with cells one particle diameter wide,
+// so each particle is only tested against the 27 cells around it. Occupied
+// cells are found by sorting rather than hashing, which keeps the contact
+// order deterministic.
+class UniformGridContact : public ParticleCollision
+{
+public:
+    virtual unsigned addContactChecked(ParticleContact* contact, unsigned limit, bool* truncated) const;
+
+private:
+    struct Cell
+    {
+        int x;
+
+        int y;
+
+        int z;
+
+        unsigned particle;
+
+        bool operator<(const Cell& other) const;
+    };
+
+    // Rebuilt every call; kept to avoid reallocating each frame
+    mutable std::vector<Cell> cells;
+};
+
+#endif
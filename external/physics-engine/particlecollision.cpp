@@ -0,0 +1,49 @@
+#include "include/particlecollision.hpp"
+#include <assert.h>
+
+ParticleCollision::ParticleCollision() : particles(NULL), radius(0.5f), restitution(0.2f) {}
+
+void ParticleCollision::init(const std::vector<Particle*>& particles, float radius, float restitution)
+{
+    assert(radius > 0.0f);
+
+    ParticleCollision::particles = &particles;
+    ParticleCollision::radius = radius;
+    ParticleCollision::restitution = restitution;
+}
+
+unsigned ParticleCollision::addContact(ParticleContact* contact, unsigned limit) const
+{
+    bool truncated;
+    return addContactChecked(contact, limit, &truncated);
+}
+
+bool ParticleCollision::addPairContact(ParticleContact* contact, Particle* a, Particle* b) const
+{
+    // Two sleeping particles stay as they are; one awake particle wakes the other on resolve
+    if (!a->getAwake() && !b->getAwake()) return false;
+
+    Vector3 midline = a->getPosition() - b->getPosition();
+    float distanceSquared = midline * midline;
+    float contactDistance = radius * 2.0f;
+
+    if (distanceSquared >= contactDistance * contactDistance) return false;
+
+    float distance = sqrtf(distanceSquared);
+
+    // Coincident particles have no meaningful direction, so push them apart vertically
+    if (distance > 0.0f)
+    {
+        contact->contactNormal = midline * (1.0f / distance);
+    }
+    else
+    {
+        contact->contactNormal = Vector3::UP;
+    }
+
+    contact->particle[0] = a;
+    contact->particle[1] = b;
+    contact->penetration = contactDistance - distance;
+    contact->restitution = restitution;
+    return true;
+}
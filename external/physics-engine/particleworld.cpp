@@ -0,0 +1,623 @@
+#include "include/particleworld.hpp"
+#include "include/simd.hpp"
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
+
+const ParticleHandle ParticleWorld::INVALID_HANDLE = 0xFFFFFFFFu;
+
+// Particle::updateMotion with the bias worked out once per step; returns
+// false when the particle falls asleep
+static bool updateMotion(float& motion, float currentMotion, float bias, float sleepEpsilon)
+{
+    motion = bias * motion + (1.0f - bias) * currentMotion;
+    if (motion < sleepEpsilon) return false;
+
+    // Cap it so a fast object can settle in reasonable time
+    if (motion > 10.0f * sleepEpsilon) motion = 10.0f * sleepEpsilon;
+    return true;
+}
+
+ParticleWorld::ParticleWorld() : factorDeltaTime(0.0f), motionBias(1.0f), viewCount(0) {}
+
+ParticleWorld::~ParticleWorld()
+{
+    for (unsigned i = 0; i < viewChunks.size(); i++)
+    {
+        delete[] viewChunks[i];
+    }
+}
+
+ParticleHandle ParticleWorld::addParticle(const Particle& particle)
+{
+    ParticleHandle handle;
+    if (!freeHandles.empty())
+    {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    }
+    else
+    {
+        handle = (ParticleHandle)handleToIndex.size();
+        handleToIndex.push_back(INVALID_HANDLE);
+    }
+
+    unsigned index = (unsigned)indexToHandle.size();
+    handleToIndex[handle] = index;
+    indexToHandle.push_back(handle);
+
+    Vector3 position = particle.getPosition();
+    Vector3 velocity = particle.getVelocity();
+    Vector3 acceleration = particle.getAcceleration();
+
+    positionX.push_back(position.x);
+    positionY.push_back(position.y);
+    positionZ.push_back(position.z);
+    velocityX.push_back(velocity.x);
+    velocityY.push_back(velocity.y);
+    velocityZ.push_back(velocity.z);
+    accelerationX.push_back(acceleration.x);
+    accelerationY.push_back(acceleration.y);
+    accelerationZ.push_back(acceleration.z);
+    inverseMass.push_back(particle.getInverseMass());
+    awake.push_back(particle.getAwake() ? 1.0f : 0.0f);
+    canSleep.push_back(particle.getCanSleep() ? 1.0f : 0.0f);
+    motion.push_back(particle.getMotion());
+    views.push_back(NULL);
+
+    unsigned dampingIndex = acquireDampingClass(particle.getDamping());
+    damping.push_back(particle.getDamping());
+    dampingClass.push_back(dampingIndex);
+    dampingFactor.push_back(dampingValueFactors[dampingIndex]);
+
+    return handle;
+}
+
+void ParticleWorld::removeParticle(ParticleHandle handle)
+{
+    assert(isValid(handle));
+
+    unsigned index = handleToIndex[handle];
+    unsigned last = (unsigned)indexToHandle.size() - 1;
+
+    releaseDampingClass(dampingClass[index]);
+
+    // Leave the viewed range first, then swap with the last particle so the
+    // arrays stay packed
+    if (views[index])
+    {
+        viewCount--;
+        swapParticles(index, viewCount);
+        index = viewCount;
+    }
+    swapParticles(index, last);
+
+    positionX.pop_back();
+    positionY.pop_back();
+    positionZ.pop_back();
+    velocityX.pop_back();
+    velocityY.pop_back();
+    velocityZ.pop_back();
+    accelerationX.pop_back();
+    accelerationY.pop_back();
+    accelerationZ.pop_back();
+    damping.pop_back();
+    inverseMass.pop_back();
+    awake.pop_back();
+    canSleep.pop_back();
+    motion.pop_back();
+    dampingFactor.pop_back();
+    dampingClass.pop_back();
+    views.pop_back();
+    indexToHandle.pop_back();
+
+    handleToIndex[handle] = INVALID_HANDLE;
+    freeHandles.push_back(handle);
+}
+
+bool ParticleWorld::isValid(ParticleHandle handle) const
+{
+    return handle < handleToIndex.size() && handleToIndex[handle] != INVALID_HANDLE;
+}
+
+unsigned ParticleWorld::getParticleCount() const
+{
+    return (unsigned)indexToHandle.size();
+}
+
+Particle* ParticleWorld::getParticle(ParticleHandle handle)
+{
+    assert(isValid(handle));
+
+    unsigned index = handleToIndex[handle];
+    if (!views[index])
+    {
+        // Join the viewed range at the front of the arrays
+        swapParticles(index, viewCount);
+        index = viewCount++;
+
+        views[index] = viewSlot(handle);
+        pushView(index);
+    }
+    return views[index];
+}
+
+void ParticleWorld::setPosition(ParticleHandle handle, const Vector3& value)
+{
+    unsigned index = handleToIndex[handle];
+    positionX[index] = value.x;
+    positionY[index] = value.y;
+    positionZ[index] = value.z;
+    if (views[index]) views[index]->setPosition(value);
+}
+
+Vector3 ParticleWorld::getPosition(ParticleHandle handle) const
+{
+    unsigned index = handleToIndex[handle];
+    if (views[index]) return views[index]->getPosition();
+    return Vector3(positionX[index], positionY[index], positionZ[index]);
+}
+
+void ParticleWorld::setVelocity(ParticleHandle handle, const Vector3& value)
+{
+    unsigned index = handleToIndex[handle];
+    velocityX[index] = value.x;
+    velocityY[index] = value.y;
+    velocityZ[index] = value.z;
+    if (views[index]) views[index]->setVelocity(value);
+}
+
+Vector3 ParticleWorld::getVelocity(ParticleHandle handle) const
+{
+    unsigned index = handleToIndex[handle];
+    if (views[index]) return views[index]->getVelocity();
+    return Vector3(velocityX[index], velocityY[index], velocityZ[index]);
+}
+
+void ParticleWorld::setAcceleration(ParticleHandle handle, const Vector3& value)
+{
+    unsigned index = handleToIndex[handle];
+    accelerationX[index] = value.x;
+    accelerationY[index] = value.y;
+    accelerationZ[index] = value.z;
+    if (views[index]) views[index]->setAcceleration(value);
+}
+
+Vector3 ParticleWorld::getAcceleration(ParticleHandle handle) const
+{
+    unsigned index = handleToIndex[handle];
+    if (views[index]) return views[index]->getAcceleration();
+    return Vector3(accelerationX[index], accelerationY[index], accelerationZ[index]);
+}
+
+void ParticleWorld::setDamping(ParticleHandle handle, float value)
+{
+    unsigned index = handleToIndex[handle];
+    setDampingClass(index, value);
+    if (views[index]) views[index]->setDamping(value);
+}
+
+float ParticleWorld::getDamping(ParticleHandle handle) const
+{
+    unsigned index = handleToIndex[handle];
+    if (views[index]) return views[index]->getDamping();
+    return damping[index];
+}
+
+void ParticleWorld::setInverseMass(ParticleHandle handle, float value)
+{
+    unsigned index = handleToIndex[handle];
+    inverseMass[index] = value;
+    if (views[index]) views[index]->setInverseMass(value);
+}
+
+float ParticleWorld::getInverseMass(ParticleHandle handle) const
+{
+    unsigned index = handleToIndex[handle];
+    if (views[index]) return views[index]->getInverseMass();
+    return inverseMass[index];
+}
+
+void ParticleWorld::setAwake(ParticleHandle handle, bool value)
+{
+    unsigned index = handleToIndex[handle];
+    if (value)
+    {
+        awake[index] = 1.0f;
+
+        // Give it a little motion so it doesn't fall straight back asleep
+        motion[index] = getSleepEpsilon() * 2.0f;
+    }
+    else
+    {
+        awake[index] = 0.0f;
+        velocityX[index] = 0.0f;
+        velocityY[index] = 0.0f;
+        velocityZ[index] = 0.0f;
+    }
+    if (views[index]) views[index]->setAwake(value);
+}
+
+bool ParticleWorld::getAwake(ParticleHandle handle) const
+{
+    unsigned index = handleToIndex[handle];
+    if (views[index]) return views[index]->getAwake();
+    return awake[index] != 0.0f;
+}
+
+void ParticleWorld::setCanSleep(ParticleHandle handle, bool value)
+{
+    unsigned index = handleToIndex[handle];
+    if (views[index])
+    {
+        views[index]->setCanSleep(value);
+        return;
+    }
+
+    canSleep[index] = value ? 1.0f : 0.0f;
+    if (!value && awake[index] == 0.0f) setAwake(handle);
+}
+
+bool ParticleWorld::getCanSleep(ParticleHandle handle) const
+{
+    unsigned index = handleToIndex[handle];
+    if (views[index]) return views[index]->getCanSleep();
+    return canSleep[index] != 0.0f;
+}
+
+float ParticleWorld::getMotion(ParticleHandle handle) const
+{
+    unsigned index = handleToIndex[handle];
+    if (views[index]) return views[index]->getMotion();
+    return motion[index];
+}
+
+void ParticleWorld::integrate(float deltaTime)
+{
+    assert(deltaTime > 0.0f);
+
+    unsigned count = getParticleCount();
+    unsigned i = viewCount;
+
+    updateDampingFactors(deltaTime);
+    integrateViews(deltaTime);
+
+#if defined(PHYSICS_SIMD_AVX)
+    const float sleepEpsilon = getSleepEpsilon();
+    const __m256 dt = _mm256_set1_ps(deltaTime);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 bias = _mm256_set1_ps(motionBias);
+    const __m256 oneMinusBias = _mm256_set1_ps(1.0f - motionBias);
+    const __m256 epsilon = _mm256_set1_ps(sleepEpsilon);
+    const __m256 motionCap = _mm256_set1_ps(10.0f * sleepEpsilon);
+
+    for (; i + 8 <= count; i += 8)
+    {
+        // Particles asleep or with infinite mass are left untouched
+        __m256 awakeLanes = _mm256_loadu_ps(&awake[i]);
+        __m256 active = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&inverseMass[i]), zero, _CMP_GT_OQ),
+            _mm256_cmp_ps(awakeLanes, zero, _CMP_NEQ_UQ));
+        if (_mm256_movemask_ps(active) == 0) continue;
+
+        __m256 factor = _mm256_loadu_ps(&dampingFactor[i]);
+
+        float* positions[3] = { &positionX[i], &positionY[i], &positionZ[i] };
+        float* velocities[3] = { &velocityX[i], &velocityY[i], &velocityZ[i] };
+        const float* accelerations[3] = { &accelerationX[i], &accelerationY[i], &accelerationZ[i] };
+
+        __m256 v[3];
+        __m256 newV[3];
+        for (unsigned axis = 0; axis < 3; axis++)
+        {
+            __m256 p = _mm256_loadu_ps(positions[axis]);
+            __m256 a = _mm256_loadu_ps(accelerations[axis]);
+            v[axis] = _mm256_loadu_ps(velocities[axis]);
+
+            __m256 newP = _mm256_add_ps(p, _mm256_mul_ps(v[axis], dt));
+            newV[axis] = _mm256_mul_ps(_mm256_add_ps(v[axis], _mm256_mul_ps(a, dt)), factor);
+
+            _mm256_storeu_ps(positions[axis], _mm256_blendv_ps(p, newP, active));
+        }
+
+        // Recency-weighted average of squared speed, for particles that can sleep
+        __m256 speed = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(newV[0], newV[0]), _mm256_mul_ps(newV[1], newV[1])), _mm256_mul_ps(newV[2], newV[2]));
+        __m256 m = _mm256_loadu_ps(&motion[i]);
+        __m256 newM = _mm256_add_ps(_mm256_mul_ps(bias, m), _mm256_mul_ps(oneMinusBias, speed));
+        __m256 tracked = _mm256_and_ps(active, _mm256_cmp_ps(_mm256_loadu_ps(&canSleep[i]), zero, _CMP_NEQ_UQ));
+        __m256 fallAsleep = _mm256_and_ps(tracked, _mm256_cmp_ps(newM, epsilon, _CMP_LT_OQ));
+
+        _mm256_storeu_ps(&motion[i], _mm256_blendv_ps(m, _mm256_min_ps(newM, motionCap), tracked));
+        _mm256_storeu_ps(&awake[i], _mm256_blendv_ps(awakeLanes, zero, fallAsleep));
+
+        for (unsigned axis = 0; axis < 3; axis++)
+        {
+            __m256 stepped = _mm256_blendv_ps(newV[axis], zero, fallAsleep);
+            _mm256_storeu_ps(velocities[axis], _mm256_blendv_ps(v[axis], stepped, active));
+        }
+    }
+#elif defined(PHYSICS_SIMD_SSE)
+    const float sleepEpsilon = getSleepEpsilon();
+    const __m128 dt = _mm_set1_ps(deltaTime);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 bias = _mm_set1_ps(motionBias);
+    const __m128 oneMinusBias = _mm_set1_ps(1.0f - motionBias);
+    const __m128 epsilon = _mm_set1_ps(sleepEpsilon);
+    const __m128 motionCap = _mm_set1_ps(10.0f * sleepEpsilon);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        // Particles asleep or with infinite mass are left untouched
+        __m128 awakeLanes = _mm_loadu_ps(&awake[i]);
+        __m128 active = _mm_and_ps(_mm_cmpgt_ps(_mm_loadu_ps(&inverseMass[i]), zero), _mm_cmpneq_ps(awakeLanes, zero));
+        if (_mm_movemask_ps(active) == 0) continue;
+
+        __m128 factor = _mm_loadu_ps(&dampingFactor[i]);
+
+        float* positions[3] = { &positionX[i], &positionY[i], &positionZ[i] };
+        float* velocities[3] = { &velocityX[i], &velocityY[i], &velocityZ[i] };
+        const float* accelerations[3] = { &accelerationX[i], &accelerationY[i], &accelerationZ[i] };
+
+        __m128 v[3];
+        __m128 newV[3];
+        for (unsigned axis = 0; axis < 3; axis++)
+        {
+            __m128 p = _mm_loadu_ps(positions[axis]);
+            __m128 a = _mm_loadu_ps(accelerations[axis]);
+            v[axis] = _mm_loadu_ps(velocities[axis]);
+
+            __m128 newP = _mm_add_ps(p, _mm_mul_ps(v[axis], dt));
+            newV[axis] = _mm_mul_ps(_mm_add_ps(v[axis], _mm_mul_ps(a, dt)), factor);
+
+            _mm_storeu_ps(positions[axis], _mm_or_ps(_mm_and_ps(active, newP), _mm_andnot_ps(active, p)));
+        }
+
+        // Recency-weighted average of squared speed, for particles that can sleep
+        __m128 speed = _mm_add_ps(_mm_add_ps(_mm_mul_ps(newV[0], newV[0]), _mm_mul_ps(newV[1], newV[1])), _mm_mul_ps(newV[2], newV[2]));
+        __m128 m = _mm_loadu_ps(&motion[i]);
+        __m128 newM = _mm_add_ps(_mm_mul_ps(bias, m), _mm_mul_ps(oneMinusBias, speed));
+        __m128 tracked = _mm_and_ps(active, _mm_cmpneq_ps(_mm_loadu_ps(&canSleep[i]), zero));
+        __m128 fallAsleep = _mm_and_ps(tracked, _mm_cmplt_ps(newM, epsilon));
+
+        _mm_storeu_ps(&motion[i], _mm_or_ps(_mm_and_ps(tracked, _mm_min_ps(newM, motionCap)), _mm_andnot_ps(tracked, m)));
+        _mm_storeu_ps(&awake[i], _mm_andnot_ps(fallAsleep, awakeLanes));
+
+        for (unsigned axis = 0; axis < 3; axis++)
+        {
+            __m128 stepped = _mm_andnot_ps(fallAsleep, newV[axis]);
+            _mm_storeu_ps(velocities[axis], _mm_or_ps(_mm_and_ps(active, stepped), _mm_andnot_ps(active, v[axis])));
+        }
+    }
+#endif
+
+    // Remaining particles that don't fill a vector
+    integrateRange(i, count, deltaTime);
+}
+
+void ParticleWorld::integrateScalar(float deltaTime)
+{
+    assert(deltaTime > 0.0f);
+
+    updateDampingFactors(deltaTime);
+    integrateViewsScalar(deltaTime);
+    integrateRange(viewCount, getParticleCount(), deltaTime);
+}
+
+void ParticleWorld::integrateRange(unsigned begin, unsigned end, float deltaTime)
+{
+    const float sleepEpsilon = getSleepEpsilon();
+
+    for (unsigned i = begin; i < end; i++)
+    {
+        // Skip integrating objects that are asleep or have infinite mass
+        if (awake[i] == 0.0f || inverseMass[i] <= 0.0f) continue;
+
+        // Update position
+        positionX[i] += velocityX[i] * deltaTime;
+        positionY[i] += velocityY[i] * deltaTime;
+        positionZ[i] += velocityZ[i] * deltaTime;
+
+        // Update velocity and impose drag
+        velocityX[i] = (velocityX[i] + accelerationX[i] * deltaTime) * dampingFactor[i];
+        velocityY[i] = (velocityY[i] + accelerationY[i] * deltaTime) * dampingFactor[i];
+        velocityZ[i] = (velocityZ[i] + accelerationZ[i] * deltaTime) * dampingFactor[i];
+
+        float currentMotion = velocityX[i] * velocityX[i] + velocityY[i] * velocityY[i] + velocityZ[i] * velocityZ[i];
+        if (canSleep[i] != 0.0f && !updateMotion(motion[i], currentMotion, motionBias, sleepEpsilon))
+        {
+            awake[i] = 0.0f;
+            velocityX[i] = 0.0f;
+            velocityY[i] = 0.0f;
+            velocityZ[i] = 0.0f;
+        }
+    }
+}
+
+void ParticleWorld::updateDampingFactors(float deltaTime)
+{
+    if (deltaTime == factorDeltaTime) return;
+
+    // One powf per distinct damping value instead of one per particle
+    factorDeltaTime = deltaTime;
+    motionBias = powf(0.5f, deltaTime);
+    for (unsigned c = 0; c < dampingValues.size(); c++)
+    {
+        if (dampingReferences[c] > 0) dampingValueFactors[c] = powf(dampingValues[c], deltaTime);
+    }
+
+    for (unsigned i = 0; i < dampingClass.size(); i++)
+    {
+        dampingFactor[i] = dampingValueFactors[dampingClass[i]];
+    }
+}
+
+void ParticleWorld::setDampingClass(unsigned index, float value)
+{
+    if (damping[index] == value) return;
+
+    unsigned dampingIndex = acquireDampingClass(value);
+    releaseDampingClass(dampingClass[index]);
+    damping[index] = value;
+    dampingClass[index] = dampingIndex;
+    dampingFactor[index] = dampingValueFactors[dampingIndex];
+}
+
+unsigned ParticleWorld::acquireDampingClass(float value)
+{
+    std::map<float, unsigned>::iterator found = dampingClasses.find(value);
+    if (found != dampingClasses.end())
+    {
+        dampingReferences[found->second]++;
+        return found->second;
+    }
+
+    unsigned dampingIndex;
+    if (!freeDampingClasses.empty())
+    {
+        dampingIndex = freeDampingClasses.back();
+        freeDampingClasses.pop_back();
+    }
+    else
+    {
+        dampingIndex = (unsigned)dampingValues.size();
+        dampingValues.push_back(0.0f);
+        dampingValueFactors.push_back(0.0f);
+        dampingReferences.push_back(0);
+    }
+
+    dampingValues[dampingIndex] = value;
+    dampingValueFactors[dampingIndex] = factorDeltaTime > 0.0f ? powf(value, factorDeltaTime) : 1.0f;
+    dampingReferences[dampingIndex] = 1;
+    dampingClasses[value] = dampingIndex;
+    return dampingIndex;
+}
+
+void ParticleWorld::releaseDampingClass(unsigned dampingIndex)
+{
+    if (--dampingReferences[dampingIndex] > 0) return;
+
+    dampingClasses.erase(dampingValues[dampingIndex]);
+    freeDampingClasses.push_back(dampingIndex);
+}
+
+void ParticleWorld::integrateViews(float deltaTime)
+{
+    // A viewed particle lives in its view, where contact resolution and game
+    // code change it, so it is stepped there rather than copied in and out;
+    // copying every view into the arrays and back costs more memory traffic
+    // than the kernel saves. Each view is stepped with its vectors loaded
+    // whole: position, velocity and acceleration sit back to back, and the
+    // fourth lane of each spills into the next vector, so it is kept as loaded.
+#if defined(PHYSICS_SIMD_SSE)
+    static_assert(offsetof(Particle, velocity) == offsetof(Particle, position) + 3 * sizeof(float) &&
+        offsetof(Particle, acceleration) == offsetof(Particle, velocity) + 3 * sizeof(float) &&
+        offsetof(Particle, damping) == offsetof(Particle, acceleration) + 3 * sizeof(float), "views are read four floats at a time");
+
+    const float sleepEpsilon = getSleepEpsilon();
+    const __m128 dt = _mm_set1_ps(deltaTime);
+    const __m128 xyz = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+
+    for (unsigned i = 0; i < viewCount; i++)
+    {
+        Particle* view = views[i];
+        if (view->damping != damping[i]) setDampingClass(i, view->damping);
+
+        // Skip integrating objects that are asleep or have infinite mass
+        if (!view->isAwake || view->inverseMass <= 0.0f) continue;
+
+        __m128 p = _mm_loadu_ps(&view->position.x);
+        __m128 v = _mm_loadu_ps(&view->velocity.x);
+        __m128 a = _mm_loadu_ps(&view->acceleration.x);
+
+        // The velocity store rewrites the lane the position store spills into
+        __m128 newV = _mm_mul_ps(_mm_add_ps(v, _mm_mul_ps(a, dt)), _mm_set1_ps(dampingFactor[i]));
+        newV = _mm_or_ps(_mm_and_ps(xyz, newV), _mm_andnot_ps(xyz, v));
+        _mm_storeu_ps(&view->position.x, _mm_add_ps(p, _mm_mul_ps(v, dt)));
+        _mm_storeu_ps(&view->velocity.x, newV);
+
+        if (!view->canSleep) continue;
+
+        // Squared speed summed in the same order as Vector3's scalar product
+        __m128 squares = _mm_mul_ps(newV, newV);
+        __m128 speed = _mm_add_ss(_mm_add_ss(squares, _mm_shuffle_ps(squares, squares, 1)), _mm_movehl_ps(squares, squares));
+        if (!updateMotion(view->motion, _mm_cvtss_f32(speed), motionBias, sleepEpsilon))
+        {
+            view->setAwake(false);
+        }
+    }
+#else
+    integrateViewsScalar(deltaTime);
+#endif
+}
+
+void ParticleWorld::integrateViewsScalar(float deltaTime)
+{
+    const float sleepEpsilon = getSleepEpsilon();
+
+    for (unsigned i = 0; i < viewCount; i++)
+    {
+        Particle* view = views[i];
+        if (view->damping != damping[i]) setDampingClass(i, view->damping);
+
+        // Skip integrating objects that are asleep or have infinite mass
+        if (!view->isAwake || view->inverseMass <= 0.0f) continue;
+
+        view->position += view->velocity * deltaTime;
+        view->velocity = (view->velocity + view->acceleration * deltaTime) * dampingFactor[i];
+
+        if (view->canSleep && !updateMotion(view->motion, view->velocity * view->velocity, motionBias, sleepEpsilon))
+        {
+            view->setAwake(false);
+        }
+    }
+}
+
+void ParticleWorld::pushView(unsigned index)
+{
+    Particle* view = views[index];
+    view->setPosition(positionX[index], positionY[index], positionZ[index]);
+    view->setVelocity(velocityX[index], velocityY[index], velocityZ[index]);
+    view->setAcceleration(accelerationX[index], accelerationY[index], accelerationZ[index]);
+    view->setDamping(damping[index]);
+    view->setInverseMass(inverseMass[index]);
+    view->isAwake = awake[index] != 0.0f;
+    view->canSleep = canSleep[index] != 0.0f;
+    view->motion = motion[index];
+}
+
+void ParticleWorld::swapParticles(unsigned a, unsigned b)
+{
+    if (a == b) return;
+
+    std::swap(positionX[a], positionX[b]);
+    std::swap(positionY[a], positionY[b]);
+    std::swap(positionZ[a], positionZ[b]);
+    std::swap(velocityX[a], velocityX[b]);
+    std::swap(velocityY[a], velocityY[b]);
+    std::swap(velocityZ[a], velocityZ[b]);
+    std::swap(accelerationX[a], accelerationX[b]);
+    std::swap(accelerationY[a], accelerationY[b]);
+    std::swap(accelerationZ[a], accelerationZ[b]);
+    std::swap(damping[a], damping[b]);
+    std::swap(inverseMass[a], inverseMass[b]);
+    std::swap(awake[a], awake[b]);
+    std::swap(canSleep[a], canSleep[b]);
+    std::swap(motion[a], motion[b]);
+    std::swap(dampingFactor[a], dampingFactor[b]);
+    std::swap(dampingClass[a], dampingClass[b]);
+    std::swap(views[a], views[b]);
+    std::swap(indexToHandle[a], indexToHandle[b]);
+
+    handleToIndex[indexToHandle[a]] = a;
+    handleToIndex[indexToHandle[b]] = b;
+}
+
+Particle* ParticleWorld::viewSlot(ParticleHandle handle)
+{
+    unsigned chunk = handle / VIEW_CHUNK_SIZE;
+    while (viewChunks.size() <= chunk)
+    {
+        viewChunks.push_back(new Particle[VIEW_CHUNK_SIZE]);
+    }
+    return &viewChunks[chunk][handle % VIEW_CHUNK_SIZE];
+}
@@ -2,6 +2,13 @@
 
 void ParticleContact::resolve(float duration)
 {
+    // An awake particle hitting a sleeping one wakes it
+    if (particle[1] && particle[0]->getAwake() != particle[1]->getAwake())
+    {
+        if (particle[0]->getAwake()) particle[1]->setAwake();
+        else particle[0]->setAwake();
+    }
+
     resolveVelocity(duration);
     resolveInterpenetration(duration);
 }
@@ -13,6 +20,32 @@ float ParticleContact::calculateSeparatingVelocity() const
     return relativeVelocity * contactNormal;
 }
 
+void ParticleContact::updatePenetration(const ParticleContact& resolved)
+{
+    const Vector3* move = resolved.particleMovement;
+
+    if (particle[0] == resolved.particle[0])
+    {
+        penetration -= move[0] * contactNormal;
+    }
+    else if (particle[0] == resolved.particle[1])
+    {
+        penetration -= move[1] * contactNormal;
+    }
+
+    if (particle[1])
+    {
+        if (particle[1] == resolved.particle[0])
+        {
+            penetration += move[0] * contactNormal;
+        }
+        else if (particle[1] == resolved.particle[1])
+        {
+            penetration += move[1] * contactNormal;
+        }
+    }
+}
+
 void ParticleContact::resolveVelocity(float duration)
 {
     float separatingVelocity = calculateSeparatingVelocity();
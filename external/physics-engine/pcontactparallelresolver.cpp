@@ -0,0 +1,223 @@
+#include "include/pcontactparallelresolver.hpp"
+#include "include/profiler.hpp"
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+const unsigned ParticleContactParallelResolver::NO_CONTACT;
+const unsigned ParticleContactParallelResolver::GRAIN_SIZE;
+
+ParticleContactParallelResolver::ParticleContactParallelResolver(unsigned iterations, unsigned threadCount) : iterations(iterations), iterationsUsed(0), pool(threadCount) {}
+
+void ParticleContactParallelResolver::setIterations(unsigned iterations)
+{
+    ParticleContactParallelResolver::iterations = iterations;
+}
+
+unsigned ParticleContactParallelResolver::getIterationsUsed() const
+{
+    return iterationsUsed;
+}
+
+unsigned ParticleContactParallelResolver::getBatchCount() const
+{
+    return batchStart.empty() ? 0 : (unsigned)batchStart.size() - 1;
+}
+
+void ParticleContactParallelResolver::resolveContacts(ParticleContact* contactArray, unsigned numContacts, float duration)
+{
+    PROFILE_ZONE("resolveContacts");
+
+    iterationsUsed = 0;
+    if (numContacts == 0) return;
+
+    buildParticleIndices(contactArray, numContacts);
+    colourContacts(numContacts);
+    movedBy.assign(particles.size(), NO_CONTACT);
+
+    unsigned numBatches = getBatchCount();
+    while (iterationsUsed < iterations)
+    {
+        unsigned resolvedThisPass = 0;
+        for (unsigned b = 0; b < numBatches && iterationsUsed < iterations; b++)
+        {
+            unsigned resolved = resolveBatch(contactArray, b, duration);
+            if (resolved == 0) continue;
+
+            updatePenetrations(contactArray, numContacts, b);
+            iterationsUsed += resolved;
+            resolvedThisPass += resolved;
+        }
+
+        // Terminate if nothing needed resolving
+        if (resolvedThisPass == 0) break;
+    }
+
+    PROFILE_COUNTER("iterationsUsed", iterationsUsed);
+}
+
+void ParticleContactParallelResolver::buildParticleIndices(ParticleContact* contactArray, unsigned numContacts)
+{
+    // Dense particle indices let the batches use flat arrays instead of maps
+    particles.clear();
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        particles.push_back(contactArray[i].particle[0]);
+        if (contactArray[i].particle[1]) particles.push_back(contactArray[i].particle[1]);
+    }
+    std::sort(particles.begin(), particles.end(), std::less<const Particle*>());
+    particles.erase(std::unique(particles.begin(), particles.end()), particles.end());
+
+    contactParticles.resize(numContacts * 2);
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        for (unsigned k = 0; k < 2; k++)
+        {
+            const Particle* particle = contactArray[i].particle[k];
+            if (!particle)
+            {
+                contactParticles[i * 2 + k] = NO_CONTACT;
+                continue;
+            }
+
+            contactParticles[i * 2 + k] = (unsigned)(std::lower_bound(particles.begin(), particles.end(), particle, std::less<const Particle*>()) - particles.begin());
+        }
+    }
+}
+
+void ParticleContactParallelResolver::colourContacts(unsigned numContacts)
+{
+    // Greedy colouring in contact order: take the lowest colour neither particle
+    // uses yet. Particles in more than 64 contacts spill into colours past 64.
+    particleColours.assign(particles.size(), 0);
+    particleOverflow.assign(particles.size(), 64);
+    contactColour.resize(numContacts);
+
+    unsigned numBatches = 0;
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        unsigned p0 = contactParticles[i * 2];
+        unsigned p1 = contactParticles[i * 2 + 1];
+
+        unsigned long long used = particleColours[p0];
+        if (p1 != NO_CONTACT) used |= particleColours[p1];
+
+        unsigned colour = 64;
+        for (unsigned bit = 0; bit < 64; bit++)
+        {
+            if (!(used & (1ULL << bit)))
+            {
+                colour = bit;
+                break;
+            }
+        }
+
+        if (colour < 64)
+        {
+            particleColours[p0] |= 1ULL << colour;
+            if (p1 != NO_CONTACT) particleColours[p1] |= 1ULL << colour;
+        }
+        else
+        {
+            colour = particleOverflow[p0];
+            if (p1 != NO_CONTACT) colour = std::max(colour, particleOverflow[p1]);
+            particleOverflow[p0] = colour + 1;
+            if (p1 != NO_CONTACT) particleOverflow[p1] = colour + 1;
+        }
+
+        contactColour[i] = colour;
+        numBatches = std::max(numBatches, colour + 1);
+    }
+
+    // Counting sort into batches, keeping contact order within each batch
+    batchStart.assign(numBatches + 1, 0);
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        batchStart[contactColour[i] + 1]++;
+    }
+    for (unsigned b = 0; b < numBatches; b++)
+    {
+        batchStart[b + 1] += batchStart[b];
+    }
+
+    batchContacts.resize(numContacts);
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        unsigned colour = contactColour[i];
+        batchContacts[batchStart[colour]] = i;
+        batchStart[colour]++;
+    }
+
+    // Filling advanced each start to the next batch's start; shift them back
+    for (unsigned b = numBatches; b > 0; b--)
+    {
+        batchStart[b] = batchStart[b - 1];
+    }
+    batchStart[0] = 0;
+}
+
+unsigned ParticleContactParallelResolver::resolveBatch(ParticleContact* contactArray, unsigned batch, float duration)
+{
+    unsigned start = batchStart[batch];
+    unsigned count = batchStart[batch + 1] - start;
+
+    chunkResolved.assign((count + GRAIN_SIZE - 1) / GRAIN_SIZE, 0);
+
+    pool.parallelFor(count, GRAIN_SIZE, [&](unsigned begin, unsigned end) {
+        unsigned resolved = 0;
+        for (unsigned k = begin; k < end; k++)
+        {
+            unsigned i = batchContacts[start + k];
+            ParticleContact& contact = contactArray[i];
+
+            // Same selection rule as the sequential resolver
+            float sepVel = contact.calculateSeparatingVelocity();
+            if (!(sepVel < std::numeric_limits<float>::max() && (sepVel < 0 || contact.penetration > 0))) continue;
+
+            // resolve() leaves the movement alone when it moves nothing
+            contact.particleMovement[0].clear();
+            contact.particleMovement[1].clear();
+            contact.resolve(duration);
+
+            // No other contact in the batch touches these particles
+            movedBy[contactParticles[i * 2]] = i;
+            if (contactParticles[i * 2 + 1] != NO_CONTACT) movedBy[contactParticles[i * 2 + 1]] = i;
+            resolved++;
+        }
+        chunkResolved[begin / GRAIN_SIZE] = resolved;
+    });
+
+    unsigned resolved = 0;
+    for (unsigned c = 0; c < chunkResolved.size(); c++)
+    {
+        resolved += chunkResolved[c];
+    }
+    return resolved;
+}
+
+void ParticleContactParallelResolver::updatePenetrations(ParticleContact* contactArray, unsigned numContacts, unsigned batch)
+{
+    // Each contact pulls the movement of at most two resolved contacts, one per particle
+    pool.parallelFor(numContacts, GRAIN_SIZE, [&](unsigned begin, unsigned end) {
+        for (unsigned i = begin; i < end; i++)
+        {
+            unsigned p1 = contactParticles[i * 2 + 1];
+            unsigned first = movedBy[contactParticles[i * 2]];
+            unsigned second = p1 != NO_CONTACT ? movedBy[p1] : NO_CONTACT;
+
+            if (first != NO_CONTACT) contactArray[i].updatePenetration(contactArray[first]);
+            if (second != NO_CONTACT && second != first) contactArray[i].updatePenetration(contactArray[second]);
+        }
+    });
+
+    // Clear the markers for the next batch
+    unsigned start = batchStart[batch];
+    pool.parallelFor(batchStart[batch + 1] - start, GRAIN_SIZE, [&](unsigned begin, unsigned end) {
+        for (unsigned k = begin; k < end; k++)
+        {
+            unsigned i = batchContacts[start + k];
+            movedBy[contactParticles[i * 2]] = NO_CONTACT;
+            if (contactParticles[i * 2 + 1] != NO_CONTACT) movedBy[contactParticles[i * 2 + 1]] = NO_CONTACT;
+        }
+    });
+}
@@ -1,15 +1,44 @@
 #include "include/pcontact.hpp"
 #include "include/pcontactresolver.hpp"
+#include "include/profiler.hpp"
+#include <algorithm>
+#include <functional>
 #include <limits>
 
-ParticleContactResolver::ParticleContactResolver(unsigned iterations) : iterations(iterations) {}
+ParticleContactResolver::ParticleContactResolver(unsigned iterations, Strategy strategy) : iterations(iterations), iterationsUsed(0), strategy(strategy) {}
 
 void ParticleContactResolver::setIterations(unsigned iterations)
 {
     ParticleContactResolver::iterations = iterations;
 }
 
+void ParticleContactResolver::setStrategy(Strategy strategy)
+{
+    ParticleContactResolver::strategy = strategy;
+}
+
+unsigned ParticleContactResolver::getIterationsUsed() const
+{
+    return iterationsUsed;
+}
+
 void ParticleContactResolver::resolveContacts(ParticleContact* contactArray, unsigned numContacts, float duration)
+{
+    PROFILE_ZONE("resolveContacts");
+
+    if (strategy == PRIORITY_QUEUE)
+    {
+        resolveContactsPriority(contactArray, numContacts, duration);
+    }
+    else
+    {
+        resolveContactsLinear(contactArray, numContacts, duration);
+    }
+
+    PROFILE_COUNTER("iterationsUsed", iterationsUsed);
+}
+
+void ParticleContactResolver::resolveContactsLinear(ParticleContact* contactArray, unsigned numContacts, float duration)
 {
     unsigned i;
     iterationsUsed = 0;
@@ -31,7 +60,165 @@ void ParticleContactResolver::resolveContacts(ParticleContact* contactArray, uns
         // Terminate if none were found
         if (maxIndex == numContacts) break;
 
-        contactArray[maxIndex].resolve(duration);
+        resolveAndTrack(contactArray[maxIndex], duration);
+
+        // Account for the movement in the penetration of every contact
+        for (i = 0; i < numContacts; i++)
+        {
+            contactArray[i].updatePenetration(contactArray[maxIndex]);
+        }
+
         iterationsUsed++;
     }
+}
+
+void ParticleContactResolver::resolveContactsPriority(ParticleContact* contactArray, unsigned numContacts, float duration)
+{
+    unsigned i;
+    iterationsUsed = 0;
+    if (numContacts == 0) return;
+
+    // Score every contact once and heapify
+    heap.resize(numContacts);
+    heapPosition.resize(numContacts);
+    priority.resize(numContacts);
+    for (i = 0; i < numContacts; i++)
+    {
+        priority[i] = priorityOf(contactArray[i]);
+        heap[i] = i;
+        heapPosition[i] = i;
+    }
+    for (i = numContacts / 2; i-- > 0;)
+    {
+        heapSiftDown(i);
+    }
+
+    // Sorted (particle, contact) pairs let us find the contacts touching a particle
+    particleContacts.clear();
+    for (i = 0; i < numContacts; i++)
+    {
+        for (unsigned k = 0; k < 2; k++)
+        {
+            if (!contactArray[i].particle[k]) continue;
+
+            ParticleContactRef ref;
+            ref.particle = contactArray[i].particle[k];
+            ref.contact = i;
+            particleContacts.push_back(ref);
+        }
+    }
+    std::sort(particleContacts.begin(), particleContacts.end());
+
+    while (iterationsUsed < iterations)
+    {
+        // Terminate if no contact needs resolving
+        unsigned top = heap[0];
+        if (priority[top] == std::numeric_limits<float>::infinity()) break;
+
+        resolveAndTrack(contactArray[top], duration);
+        iterationsUsed++;
+
+        // Only contacts that share a particle with the resolved one changed
+        affected.clear();
+        for (unsigned k = 0; k < 2; k++)
+        {
+            const Particle* moved = contactArray[top].particle[k];
+            if (!moved) continue;
+
+            ParticleContactRef key;
+            key.particle = moved;
+            key.contact = 0;
+            std::vector<ParticleContactRef>::const_iterator ref = std::lower_bound(particleContacts.begin(), particleContacts.end(), key);
+            for (; ref != particleContacts.end() && ref->particle == moved; ref++)
+            {
+                affected.push_back(ref->contact);
+            }
+        }
+        std::sort(affected.begin(), affected.end());
+        affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+
+        for (i = 0; i < affected.size(); i++)
+        {
+            contactArray[affected[i]].updatePenetration(contactArray[top]);
+        }
+        for (i = 0; i < affected.size(); i++)
+        {
+            heapUpdate(contactArray, affected[i]);
+        }
+    }
+}
+
+void ParticleContactResolver::resolveAndTrack(ParticleContact& contact, float duration)
+{
+    // resolve() leaves the movement alone when it moves nothing
+    contact.particleMovement[0].clear();
+    contact.particleMovement[1].clear();
+    contact.resolve(duration);
+}
+
+float ParticleContactResolver::priorityOf(const ParticleContact& contact) const
+{
+    // Same selection rule as the linear scan; contacts that need no work sink to the bottom
+    float sepVel = contact.calculateSeparatingVelocity();
+    if (sepVel < std::numeric_limits<float>::max() && (sepVel < 0 || contact.penetration > 0))
+    {
+        return sepVel;
+    }
+    return std::numeric_limits<float>::infinity();
+}
+
+bool ParticleContactResolver::heapLess(unsigned a, unsigned b) const
+{
+    // Ties go to the lower index, matching the linear scan
+    if (priority[a] != priority[b]) return priority[a] < priority[b];
+    return a < b;
+}
+
+void ParticleContactResolver::heapSwap(unsigned a, unsigned b)
+{
+    std::swap(heap[a], heap[b]);
+    heapPosition[heap[a]] = a;
+    heapPosition[heap[b]] = b;
+}
+
+void ParticleContactResolver::heapSiftUp(unsigned position)
+{
+    while (position > 0)
+    {
+        unsigned parent = (position - 1) / 2;
+        if (!heapLess(heap[position], heap[parent])) break;
+
+        heapSwap(position, parent);
+        position = parent;
+    }
+}
+
+void ParticleContactResolver::heapSiftDown(unsigned position)
+{
+    unsigned size = (unsigned)heap.size();
+    while (true)
+    {
+        unsigned smallest = position;
+        unsigned left = position * 2 + 1;
+        unsigned right = left + 1;
+        if (left < size && heapLess(heap[left], heap[smallest])) smallest = left;
+        if (right < size && heapLess(heap[right], heap[smallest])) smallest = right;
+        if (smallest == position) break;
+
+        heapSwap(position, smallest);
+        position = smallest;
+    }
+}
+
+void ParticleContactResolver::heapUpdate(ParticleContact* contactArray, unsigned contact)
+{
+    priority[contact] = priorityOf(contactArray[contact]);
+    heapSiftUp(heapPosition[contact]);
+    heapSiftDown(heapPosition[contact]);
+}
+
+bool ParticleContactResolver::ParticleContactRef::operator<(const ParticleContactRef& other) const
+{
+    if (particle != other.particle) return std::less<const Particle*>()(particle, other.particle);
+    return contact < other.contact;
 }
\ No newline at end of file
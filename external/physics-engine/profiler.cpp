@@ -0,0 +1,334 @@
+#include "include/profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+
+// Trace timestamps count from program start
+static const uint64_t origin = Profiler::now();
+
+Profiler& Profiler::get()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler() : nextThread(0), retiredDropped(0), windowSize(600), traceCapacity(1 << 18), traceNext(0) {}
+
+Profiler::~Profiler()
+{
+    for (unsigned i = 0; i < buffers.size(); i++)
+    {
+        delete buffers[i];
+    }
+}
+
+uint64_t Profiler::now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::recordZone(const char* name, uint64_t start, uint64_t end)
+{
+    Event event = { name, ZONE, start, end, 0.0 };
+    push(event);
+}
+
+void Profiler::recordCounter(const char* name, double value)
+{
+    uint64_t time = now();
+    Event event = { name, COUNTER, time, time, value };
+    push(event);
+}
+
+Profiler::ThreadOwner::~ThreadOwner()
+{
+    if (buffer) buffer->retired.store(true, std::memory_order_release);
+}
+
+Profiler::ThreadBuffer* Profiler::threadBuffer()
+{
+    // Registering is the only time a recording thread takes the lock
+    thread_local ThreadOwner owner = { NULL };
+    if (!owner.buffer)
+    {
+        ThreadBuffer* buffer = new ThreadBuffer();
+        std::lock_guard<std::mutex> lock(mutex);
+        buffer->thread = nextThread++;
+        buffers.push_back(buffer);
+        owner.buffer = buffer;
+    }
+    return owner.buffer;
+}
+
+void Profiler::push(const Event& event)
+{
+    ThreadBuffer* buffer = threadBuffer();
+    unsigned head = buffer->head.load(std::memory_order_relaxed);
+
+    // Drop rather than block when the frame isn't drained in time
+    if (head - buffer->tail.load(std::memory_order_acquire) >= ThreadBuffer::CAPACITY)
+    {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    buffer->events[head % ThreadBuffer::CAPACITY] = event;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::drain(ThreadBuffer* buffer)
+{
+    unsigned head = buffer->head.load(std::memory_order_acquire);
+    unsigned tail = buffer->tail.load(std::memory_order_relaxed);
+
+    for (; tail != head; tail++)
+    {
+        const Event& event = buffer->events[tail % ThreadBuffer::CAPACITY];
+
+        // Zones add up their time in the frame; counters add up their values
+        Series* s = findSeries(event.name, event.type == COUNTER);
+        s->frameValue += event.type == ZONE ? (event.end - event.start) / 1e6 : event.value;
+        s->touched = true;
+
+        if (traceCapacity == 0) continue;
+
+        TraceEvent traced = { event, buffer->thread };
+        if (trace.size() < traceCapacity)
+        {
+            trace.push_back(traced);
+        }
+        else
+        {
+            trace[traceNext] = traced;
+            traceNext = (traceNext + 1) % traceCapacity;
+        }
+    }
+
+    buffer->tail.store(head, std::memory_order_release);
+}
+
+void Profiler::drainAll(bool discard)
+{
+    unsigned kept = 0;
+    for (unsigned i = 0; i < buffers.size(); i++)
+    {
+        ThreadBuffer* buffer = buffers[i];
+
+        // Checked first, so an exited thread's last events are drained before it is freed
+        bool retired = buffer->retired.load(std::memory_order_acquire);
+        if (discard)
+        {
+            buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_release);
+        }
+        else
+        {
+            drain(buffer);
+        }
+
+        if (retired)
+        {
+            retiredDropped += buffer->dropped.load(std::memory_order_relaxed);
+            delete buffer;
+        }
+        else
+        {
+            buffers[kept++] = buffer;
+        }
+    }
+    buffers.resize(kept);
+}
+
+Profiler::Series* Profiler::findSeries(const char* name, bool counter)
+{
+    std::map<const char*, Series*>::iterator found = seriesByPointer.find(name);
+    if (found != seriesByPointer.end()) return found->second;
+
+    // Equal names from different translation units may not share a pointer
+    Series& s = series[name];
+    if (s.samples.empty())
+    {
+        s.counter = counter;
+        s.samples.resize(windowSize);
+        s.next = 0;
+        s.count = 0;
+        s.frameValue = 0.0;
+        s.touched = false;
+    }
+    seriesByPointer[name] = &s;
+    return &s;
+}
+
+void Profiler::endFrame()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    drainAll(false);
+
+    // Names that didn't show up this frame leave their window alone
+    for (std::map<std::string, Series>::iterator it = series.begin(); it != series.end(); it++)
+    {
+        Series& s = it->second;
+        if (!s.touched) continue;
+
+        s.samples[s.next] = s.frameValue;
+        s.next = (s.next + 1) % s.samples.size();
+        if (s.count < s.samples.size()) s.count++;
+
+        s.frameValue = 0.0;
+        s.touched = false;
+    }
+}
+
+void Profiler::setWindowSize(unsigned frames)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    windowSize = frames > 0 ? frames : 1;
+    for (std::map<std::string, Series>::iterator it = series.begin(); it != series.end(); it++)
+    {
+        it->second.samples.assign(windowSize, 0.0);
+        it->second.next = 0;
+        it->second.count = 0;
+    }
+}
+
+void Profiler::setTraceCapacity(unsigned events)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    traceCapacity = events;
+    trace.clear();
+    traceNext = 0;
+}
+
+void Profiler::getSummary(std::vector<Stats>& stats) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    stats.clear();
+    std::vector<double> sorted;
+    for (std::map<std::string, Series>::const_iterator it = series.begin(); it != series.end(); it++)
+    {
+        const Series& s = it->second;
+        if (s.count == 0) continue;
+
+        sorted.assign(s.samples.begin(), s.samples.begin() + s.count);
+        std::sort(sorted.begin(), sorted.end());
+
+        double total = 0.0;
+        for (unsigned i = 0; i < sorted.size(); i++)
+        {
+            total += sorted[i];
+        }
+
+        Stats entry;
+        entry.name = it->first;
+        entry.counter = s.counter;
+        entry.frames = s.count;
+        entry.min = sorted.front();
+        entry.avg = total / s.count;
+        entry.p99 = sorted[(unsigned)ceil(0.99 * s.count) - 1];
+        entry.max = sorted.back();
+        stats.push_back(entry);
+    }
+}
+
+void Profiler::printSummary(FILE* file) const
+{
+    std::vector<Stats> stats;
+    getSummary(stats);
+
+    fprintf(file, "%-24s %8s %12s %12s %12s %12s\n", "zone (ms/frame)", "frames", "min", "avg", "p99", "max");
+    for (unsigned i = 0; i < stats.size(); i++)
+    {
+        if (stats[i].counter) continue;
+        fprintf(file, "%-24s %8u %12.4f %12.4f %12.4f %12.4f\n", stats[i].name.c_str(), stats[i].frames, stats[i].min, stats[i].avg, stats[i].p99, stats[i].max);
+    }
+
+    fprintf(file, "%-24s %8s %12s %12s %12s %12s\n", "counter (per frame)", "frames", "min", "avg", "p99", "max");
+    for (unsigned i = 0; i < stats.size(); i++)
+    {
+        if (!stats[i].counter) continue;
+        fprintf(file, "%-24s %8u %12.1f %12.1f %12.1f %12.1f\n", stats[i].name.c_str(), stats[i].frames, stats[i].min, stats[i].avg, stats[i].p99, stats[i].max);
+    }
+}
+
+static void writeJsonString(FILE* file, const char* text)
+{
+    fputc('"', file);
+    for (; *text; text++)
+    {
+        if (*text == '"' || *text == '\\') fputc('\\', file);
+        fputc(*text, file);
+    }
+    fputc('"', file);
+}
+
+bool Profiler::writeChromeTrace(const char* path) const
+{
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    fprintf(file, "{\"traceEvents\":[\n");
+
+    // Oldest event first; once the ring has wrapped that is the next one to be overwritten
+    unsigned count = (unsigned)trace.size();
+    unsigned first = count < traceCapacity ? 0 : traceNext;
+    for (unsigned i = 0; i < count; i++)
+    {
+        const TraceEvent& traced = trace[(first + i) % count];
+        const Event& event = traced.event;
+        double timestamp = (double)(int64_t)(event.start - origin) / 1000.0;
+
+        fprintf(file, "{\"name\":");
+        writeJsonString(file, event.name);
+        if (event.type == ZONE)
+        {
+            fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}", timestamp, (event.end - event.start) / 1000.0, traced.thread);
+        }
+        else
+        {
+            fprintf(file, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"value\":%g}}", timestamp, traced.thread, event.value);
+        }
+        fprintf(file, i + 1 < count ? ",\n" : "\n");
+    }
+
+    fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+
+    bool written = !ferror(file);
+    return fclose(file) == 0 && written;
+}
+
+unsigned long Profiler::getDroppedCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    unsigned long dropped = retiredDropped;
+    for (unsigned i = 0; i < buffers.size(); i++)
+    {
+        dropped += buffers[i]->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+unsigned Profiler::getBufferCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return (unsigned)buffers.size();
+}
+
+void Profiler::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Drain into nothing so stale events don't land in the next frame
+    drainAll(true);
+
+    series.clear();
+    seriesByPointer.clear();
+    trace.clear();
+    traceNext = 0;
+}
@@ -0,0 +1,699 @@
+#include "include/rigidbodyworld.hpp"
+#include "include/simd.hpp"
+#include <assert.h>
+#include <math.h>
+
+const RigidBodyHandle RigidBodyWorld::INVALID_HANDLE = 0xFFFFFFFFu;
+
+// Thin wrappers so one kernel body serves the scalar, SSE and AVX paths
+
+struct Float1
+{
+    float v;
+
+    static Float1 load(const float* p) { Float1 r; r.v = *p; return r; }
+    static Float1 set(float s) { Float1 r; r.v = s; return r; }
+    void store(float* p) const { *p = v; }
+
+    friend Float1 operator+(Float1 a, Float1 b) { return set(a.v + b.v); }
+    friend Float1 operator-(Float1 a, Float1 b) { return set(a.v - b.v); }
+    friend Float1 operator*(Float1 a, Float1 b) { return set(a.v * b.v); }
+
+    // 1/sqrt(a), or ifZero where a is zero
+    static Float1 inverseSqrtOr(Float1 a, Float1 ifZero) { return set(a.v == 0.0f ? ifZero.v : 1.0f / sqrtf(a.v)); }
+    static Float1 selectZero(Float1 test, Float1 ifZero, Float1 otherwise) { return test.v == 0.0f ? ifZero : otherwise; }
+    static Float1 selectLess(Float1 a, Float1 b, Float1 ifLess, Float1 otherwise) { return a.v < b.v ? ifLess : otherwise; }
+    static Float1 minimum(Float1 a, Float1 b) { return set(a.v < b.v ? a.v : b.v); }
+};
+
+#if defined(PHYSICS_SIMD_SSE)
+struct Float4
+{
+    __m128 v;
+
+    static Float4 load(const float* p) { Float4 r; r.v = _mm_loadu_ps(p); return r; }
+    static Float4 set(float s) { Float4 r; r.v = _mm_set1_ps(s); return r; }
+    static Float4 wrap(__m128 m) { Float4 r; r.v = m; return r; }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return wrap(_mm_add_ps(a.v, b.v)); }
+    friend Float4 operator-(Float4 a, Float4 b) { return wrap(_mm_sub_ps(a.v, b.v)); }
+    friend Float4 operator*(Float4 a, Float4 b) { return wrap(_mm_mul_ps(a.v, b.v)); }
+
+    static Float4 selectZero(Float4 test, Float4 ifZero, Float4 otherwise)
+    {
+        __m128 zero = _mm_cmpeq_ps(test.v, _mm_setzero_ps());
+        return wrap(_mm_or_ps(_mm_and_ps(zero, ifZero.v), _mm_andnot_ps(zero, otherwise.v)));
+    }
+
+    static Float4 selectLess(Float4 a, Float4 b, Float4 ifLess, Float4 otherwise)
+    {
+        __m128 less = _mm_cmplt_ps(a.v, b.v);
+        return wrap(_mm_or_ps(_mm_and_ps(less, ifLess.v), _mm_andnot_ps(less, otherwise.v)));
+    }
+
+    static Float4 minimum(Float4 a, Float4 b) { return wrap(_mm_min_ps(a.v, b.v)); }
+
+    static Float4 inverseSqrtOr(Float4 a, Float4 ifZero)
+    {
+        // Full precision divide; the estimate instructions drift from the scalar path
+        return selectZero(a, ifZero, wrap(_mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(a.v))));
+    }
+};
+#endif
+
+#if defined(PHYSICS_SIMD_AVX)
+struct Float8
+{
+    __m256 v;
+
+    static Float8 load(const float* p) { Float8 r; r.v = _mm256_loadu_ps(p); return r; }
+    static Float8 set(float s) { Float8 r; r.v = _mm256_set1_ps(s); return r; }
+    static Float8 wrap(__m256 m) { Float8 r; r.v = m; return r; }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    friend Float8 operator+(Float8 a, Float8 b) { return wrap(_mm256_add_ps(a.v, b.v)); }
+    friend Float8 operator-(Float8 a, Float8 b) { return wrap(_mm256_sub_ps(a.v, b.v)); }
+    friend Float8 operator*(Float8 a, Float8 b) { return wrap(_mm256_mul_ps(a.v, b.v)); }
+
+    static Float8 selectZero(Float8 test, Float8 ifZero, Float8 otherwise)
+    {
+        __m256 zero = _mm256_cmp_ps(test.v, _mm256_setzero_ps(), _CMP_EQ_OQ);
+        return wrap(_mm256_blendv_ps(otherwise.v, ifZero.v, zero));
+    }
+
+    static Float8 selectLess(Float8 a, Float8 b, Float8 ifLess, Float8 otherwise)
+    {
+        __m256 less = _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ);
+        return wrap(_mm256_blendv_ps(otherwise.v, ifLess.v, less));
+    }
+
+    static Float8 minimum(Float8 a, Float8 b) { return wrap(_mm256_min_ps(a.v, b.v)); }
+
+    static Float8 inverseSqrtOr(Float8 a, Float8 ifZero)
+    {
+        return selectZero(a, ifZero, wrap(_mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(a.v))));
+    }
+};
+#endif
+
+// Kernels take b pointing at the first body's lane in its block; each field
+// of the following bodies sits LANES floats further on
+static float* at(float* b, unsigned field)
+{
+    return b + field * RigidBodyWorld::LANES;
+}
+
+// When MASKED, stores value only in the lanes where mask is non-zero, so
+// sleeping bodies in the other lanes keep their state. Blocks with every
+// body awake skip the extra load and blend.
+template <bool MASKED, class V>
+static void storeLanes(V mask, V value, float* p)
+{
+    if (MASKED) value = V::selectZero(mask, V::load(p), value);
+    value.store(p);
+}
+
+#if defined(PHYSICS_SIMD_SSE)
+static unsigned countAwake(float* b)
+{
+    const float* awake = at(b, RigidBodyWorld::AWAKE);
+    unsigned count = 0;
+    for (unsigned k = 0; k < RigidBodyWorld::LANES; k++)
+    {
+        if (awake[k] != 0.0f) count++;
+    }
+    return count;
+}
+#endif
+
+// Normalizes the orientation, then rebuilds the transform and world inverse
+// inertia tensor, as RigidBody::calculateDerivedData does for one body
+template <class V, bool MASKED>
+static void deriveLanes(float* b, V awake)
+{
+    V qx = V::load(at(b, RigidBodyWorld::ORIENTATION_X));
+    V qy = V::load(at(b, RigidBodyWorld::ORIENTATION_Y));
+    V qz = V::load(at(b, RigidBodyWorld::ORIENTATION_Z));
+    V qw = V::load(at(b, RigidBodyWorld::ORIENTATION_W));
+
+    V det = qx * qx + qy * qy + qz * qz + qw * qw;
+    V invDet = V::inverseSqrtOr(det, V::set(1.0f));
+    qx = qx * invDet;
+    qy = qy * invDet;
+    qz = qz * invDet;
+    qw = V::selectZero(det, V::set(1.0f), qw * invDet);
+
+    storeLanes<MASKED>(awake, qx, at(b, RigidBodyWorld::ORIENTATION_X));
+    storeLanes<MASKED>(awake, qy, at(b, RigidBodyWorld::ORIENTATION_Y));
+    storeLanes<MASKED>(awake, qz, at(b, RigidBodyWorld::ORIENTATION_Z));
+    storeLanes<MASKED>(awake, qw, at(b, RigidBodyWorld::ORIENTATION_W));
+
+    V one = V::set(1.0f);
+    V two = V::set(2.0f);
+
+    V r[12];
+    r[0] = one - two * qy * qy - two * qz * qz;
+    r[1] = two * qx * qy + two * qz * qw;
+    r[2] = two * qx * qz - two * qy * qw;
+    r[3] = V::load(at(b, RigidBodyWorld::POSITION_X));
+    r[4] = two * qx * qy - two * qz * qw;
+    r[5] = one - two * qx * qx - two * qz * qz;
+    r[6] = two * qy * qz + two * qx * qw;
+    r[7] = V::load(at(b, RigidBodyWorld::POSITION_Y));
+    r[8] = two * qx * qz + two * qy * qw;
+    r[9] = two * qy * qz - two * qx * qw;
+    r[10] = one - two * qx * qx - two * qy * qy;
+    r[11] = V::load(at(b, RigidBodyWorld::POSITION_Z));
+
+    for (unsigned k = 0; k < 12; k++)
+    {
+        storeLanes<MASKED>(awake, r[k], at(b, RigidBodyWorld::TRANSFORM + k));
+    }
+
+    V iitBody[9];
+    for (unsigned k = 0; k < 9; k++)
+    {
+        iitBody[k] = V::load(at(b, RigidBodyWorld::INVERSE_INERTIA_TENSOR + k));
+    }
+
+    // iitWorld = R * iitBody * R^T
+    V t[9];
+    for (unsigned row = 0; row < 3; row++)
+    {
+        for (unsigned col = 0; col < 3; col++)
+        {
+            t[row * 3 + col] = r[row * 4] * iitBody[col] + r[row * 4 + 1] * iitBody[3 + col] + r[row * 4 + 2] * iitBody[6 + col];
+        }
+    }
+
+    for (unsigned row = 0; row < 3; row++)
+    {
+        for (unsigned col = 0; col < 3; col++)
+        {
+            V w = t[row * 3] * r[col * 4] + t[row * 3 + 1] * r[col * 4 + 1] + t[row * 3 + 2] * r[col * 4 + 2];
+            storeLanes<MASKED>(awake, w, at(b, RigidBodyWorld::INVERSE_INERTIA_TENSOR_WORLD + row * 3 + col));
+        }
+    }
+}
+
+// One RigidBody::integrate step for the awake bodies in V's lanes.
+// motionBias is 0.5^deltaTime, as in RigidBody::updateMotion.
+template <class V, bool MASKED>
+static void integrateLanes(float* b, float deltaTime, float motionBias, float sleepEpsilon)
+{
+    V dt = V::set(deltaTime);
+    V zero = V::set(0.0f);
+    V one = V::set(1.0f);
+    V awake = V::load(at(b, RigidBodyWorld::AWAKE));
+
+    // Calculate linear acceleration
+    V inverseMass = V::load(at(b, RigidBodyWorld::INVERSE_MASS));
+    V lfa[3];
+    for (unsigned k = 0; k < 3; k++)
+    {
+        lfa[k] = V::load(at(b, RigidBodyWorld::ACCELERATION_X + k)) + V::load(at(b, RigidBodyWorld::FORCE_X + k)) * inverseMass;
+        storeLanes<MASKED>(awake, lfa[k], at(b, RigidBodyWorld::LAST_FRAME_ACCELERATION_X + k));
+    }
+
+    // Calculate angular acceleration
+    V torque[3];
+    for (unsigned k = 0; k < 3; k++)
+    {
+        torque[k] = V::load(at(b, RigidBodyWorld::TORQUE_X + k));
+    }
+
+    V angularAcceleration[3];
+    for (unsigned k = 0; k < 3; k++)
+    {
+        const unsigned row = RigidBodyWorld::INVERSE_INERTIA_TENSOR_WORLD + k * 3;
+        angularAcceleration[k] = torque[0] * V::load(at(b, row)) + torque[1] * V::load(at(b, row + 1)) + torque[2] * V::load(at(b, row + 2));
+    }
+
+    // Update velocities and impose drag
+    V linearFactor = V::load(at(b, RigidBodyWorld::LINEAR_DAMPING_FACTOR));
+    V angularFactor = V::load(at(b, RigidBodyWorld::ANGULAR_DAMPING_FACTOR));
+    V velocity[3];
+    V angularVelocity[3];
+    for (unsigned k = 0; k < 3; k++)
+    {
+        velocity[k] = (V::load(at(b, RigidBodyWorld::VELOCITY_X + k)) + lfa[k] * dt) * linearFactor;
+        angularVelocity[k] = (V::load(at(b, RigidBodyWorld::ANGULAR_VELOCITY_X + k)) + angularAcceleration[k] * dt) * angularFactor;
+
+        // Update position
+        V position = V::load(at(b, RigidBodyWorld::POSITION_X + k)) + velocity[k] * dt;
+        storeLanes<MASKED>(awake, position, at(b, RigidBodyWorld::POSITION_X + k));
+    }
+
+    // Update orientation: q += 0.5 * (w * dt) * q
+    V qx = V::load(at(b, RigidBodyWorld::ORIENTATION_X));
+    V qy = V::load(at(b, RigidBodyWorld::ORIENTATION_Y));
+    V qz = V::load(at(b, RigidBodyWorld::ORIENTATION_Z));
+    V qw = V::load(at(b, RigidBodyWorld::ORIENTATION_W));
+    V ax = angularVelocity[0] * dt;
+    V ay = angularVelocity[1] * dt;
+    V az = angularVelocity[2] * dt;
+    V half = V::set(0.5f);
+
+    storeLanes<MASKED>(awake, qx + (ax * qw + ay * qz - az * qy) * half, at(b, RigidBodyWorld::ORIENTATION_X));
+    storeLanes<MASKED>(awake, qy + (ay * qw + az * qx - ax * qz) * half, at(b, RigidBodyWorld::ORIENTATION_Y));
+    storeLanes<MASKED>(awake, qz + (az * qw + ax * qy - ay * qx) * half, at(b, RigidBodyWorld::ORIENTATION_Z));
+    storeLanes<MASKED>(awake, qw + (zero - ax * qx - ay * qy - az * qz) * half, at(b, RigidBodyWorld::ORIENTATION_W));
+
+    // Update cached data
+    deriveLanes<V, MASKED>(b, awake);
+
+    // Clean up
+    for (unsigned k = 0; k < 3; k++)
+    {
+        storeLanes<MASKED>(awake, zero, at(b, RigidBodyWorld::FORCE_X + k));
+        storeLanes<MASKED>(awake, zero, at(b, RigidBodyWorld::TORQUE_X + k));
+    }
+
+    // Recency-weighted average of squared linear and angular speed; bodies
+    // that can sleep drop off below the epsilon, otherwise motion is capped
+    V canSleep = V::load(at(b, RigidBodyWorld::CAN_SLEEP));
+    V currentMotion = (velocity[0] * velocity[0] + velocity[1] * velocity[1] + velocity[2] * velocity[2]) +
+        (angularVelocity[0] * angularVelocity[0] + angularVelocity[1] * angularVelocity[1] + angularVelocity[2] * angularVelocity[2]);
+    V bias = V::set(motionBias);
+    V motion = bias * V::load(at(b, RigidBodyWorld::MOTION)) + (one - bias) * currentMotion;
+    V fallAsleep = V::selectLess(motion, V::set(sleepEpsilon), canSleep, zero);
+
+    motion = V::selectZero(canSleep, V::load(at(b, RigidBodyWorld::MOTION)), V::minimum(motion, V::set(10.0f * sleepEpsilon)));
+    storeLanes<MASKED>(awake, motion, at(b, RigidBodyWorld::MOTION));
+    storeLanes<MASKED>(awake, awake - fallAsleep, at(b, RigidBodyWorld::AWAKE));
+
+    // Bodies falling asleep stop
+    for (unsigned k = 0; k < 3; k++)
+    {
+        storeLanes<MASKED>(awake, V::selectZero(fallAsleep, velocity[k], zero), at(b, RigidBodyWorld::VELOCITY_X + k));
+        storeLanes<MASKED>(awake, V::selectZero(fallAsleep, angularVelocity[k], zero), at(b, RigidBodyWorld::ANGULAR_VELOCITY_X + k));
+    }
+}
+
+RigidBodyWorld::RigidBodyWorld() : factorDeltaTime(0.0f), motionBias(1.0f) {}
+
+RigidBodyHandle RigidBodyWorld::addBody(const RigidBody& body)
+{
+    RigidBodyHandle handle;
+    if (!freeHandles.empty())
+    {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    }
+    else
+    {
+        handle = (RigidBodyHandle)handleToIndex.size();
+        handleToIndex.push_back(INVALID_HANDLE);
+    }
+
+    unsigned index = (unsigned)indexToHandle.size();
+    handleToIndex[handle] = index;
+    indexToHandle.push_back(handle);
+
+    // Bodies fill a block of LANES before the next one starts
+    if (index % LANES == 0) blocks.resize(blocks.size() + BLOCK_SIZE, 0.0f);
+
+    setVector(index, POSITION_X, body.position);
+    slot(index, ORIENTATION_X) = body.orientation.x;
+    slot(index, ORIENTATION_Y) = body.orientation.y;
+    slot(index, ORIENTATION_Z) = body.orientation.z;
+    slot(index, ORIENTATION_W) = body.orientation.w;
+    setVector(index, VELOCITY_X, body.velocity);
+    setVector(index, ACCELERATION_X, body.acceleration);
+    setVector(index, ANGULAR_VELOCITY_X, body.angularVelocity);
+    setVector(index, FORCE_X, body.forceAccum);
+    setVector(index, TORQUE_X, body.torqueAccum);
+    setVector(index, LAST_FRAME_ACCELERATION_X, body.lastFrameAcceleration);
+    slot(index, INVERSE_MASS) = body.inverseMass;
+    slot(index, AWAKE) = body.isAwake ? 1.0f : 0.0f;
+    slot(index, CAN_SLEEP) = body.canSleep ? 1.0f : 0.0f;
+    slot(index, MOTION) = body.motion;
+
+    for (unsigned k = 0; k < 9; k++)
+    {
+        slot(index, INVERSE_INERTIA_TENSOR + k) = body.inverseInertiaTensor.data[k];
+        slot(index, INVERSE_INERTIA_TENSOR_WORLD + k) = body.inverseInertiaTensorWorld.data[k];
+    }
+    for (unsigned k = 0; k < 12; k++)
+    {
+        slot(index, TRANSFORM + k) = body.transformMatrix.data[k];
+    }
+
+    setDamping(handle, body.linearDamping, body.angularDamping);
+
+    return handle;
+}
+
+void RigidBodyWorld::removeBody(RigidBodyHandle handle)
+{
+    assert(isValid(handle));
+
+    // Move the last body into the freed slot so the arrays stay packed
+    unsigned index = handleToIndex[handle];
+    unsigned last = (unsigned)indexToHandle.size() - 1;
+
+    for (unsigned k = 0; k < FIELD_COUNT; k++)
+    {
+        slot(index, k) = slot(last, k);
+        slot(last, k) = 0.0f;
+    }
+    if (last % LANES == 0) blocks.resize(blocks.size() - BLOCK_SIZE);
+
+    indexToHandle[index] = indexToHandle[last];
+    handleToIndex[indexToHandle[index]] = index;
+    indexToHandle.pop_back();
+
+    handleToIndex[handle] = INVALID_HANDLE;
+    freeHandles.push_back(handle);
+}
+
+bool RigidBodyWorld::isValid(RigidBodyHandle handle) const
+{
+    return handle < handleToIndex.size() && handleToIndex[handle] != INVALID_HANDLE;
+}
+
+unsigned RigidBodyWorld::getBodyCount() const
+{
+    return (unsigned)indexToHandle.size();
+}
+
+void RigidBodyWorld::getBody(RigidBodyHandle handle, RigidBody* body) const
+{
+    unsigned index = handleToIndex[handle];
+
+    body->position = getVector(index, POSITION_X);
+    body->orientation = getOrientation(handle);
+    body->velocity = getVector(index, VELOCITY_X);
+    body->acceleration = getVector(index, ACCELERATION_X);
+    body->angularVelocity = getVector(index, ANGULAR_VELOCITY_X);
+    body->forceAccum = getVector(index, FORCE_X);
+    body->torqueAccum = getVector(index, TORQUE_X);
+    body->lastFrameAcceleration = getVector(index, LAST_FRAME_ACCELERATION_X);
+    body->inverseMass = slot(index, INVERSE_MASS);
+    body->linearDamping = slot(index, LINEAR_DAMPING);
+    body->angularDamping = slot(index, ANGULAR_DAMPING);
+    body->isAwake = slot(index, AWAKE) != 0.0f;
+    body->canSleep = slot(index, CAN_SLEEP) != 0.0f;
+    body->motion = slot(index, MOTION);
+
+    for (unsigned k = 0; k < 9; k++)
+    {
+        body->inverseInertiaTensor.data[k] = slot(index, INVERSE_INERTIA_TENSOR + k);
+        body->inverseInertiaTensorWorld.data[k] = slot(index, INVERSE_INERTIA_TENSOR_WORLD + k);
+    }
+    for (unsigned k = 0; k < 12; k++)
+    {
+        body->transformMatrix.data[k] = slot(index, TRANSFORM + k);
+    }
+}
+
+void RigidBodyWorld::setPosition(RigidBodyHandle handle, const Vector3& value)
+{
+    setVector(handleToIndex[handle], POSITION_X, value);
+}
+
+Vector3 RigidBodyWorld::getPosition(RigidBodyHandle handle) const
+{
+    return getVector(handleToIndex[handle], POSITION_X);
+}
+
+void RigidBodyWorld::setOrientation(RigidBodyHandle handle, const Quaternion& value)
+{
+    unsigned index = handleToIndex[handle];
+    Quaternion q = value;
+    q.normalize();
+    slot(index, ORIENTATION_X) = q.x;
+    slot(index, ORIENTATION_Y) = q.y;
+    slot(index, ORIENTATION_Z) = q.z;
+    slot(index, ORIENTATION_W) = q.w;
+}
+
+Quaternion RigidBodyWorld::getOrientation(RigidBodyHandle handle) const
+{
+    unsigned index = handleToIndex[handle];
+    return Quaternion(slot(index, ORIENTATION_X), slot(index, ORIENTATION_Y), slot(index, ORIENTATION_Z), slot(index, ORIENTATION_W));
+}
+
+void RigidBodyWorld::setVelocity(RigidBodyHandle handle, const Vector3& value)
+{
+    setVector(handleToIndex[handle], VELOCITY_X, value);
+}
+
+Vector3 RigidBodyWorld::getVelocity(RigidBodyHandle handle) const
+{
+    return getVector(handleToIndex[handle], VELOCITY_X);
+}
+
+void RigidBodyWorld::setAngularVelocity(RigidBodyHandle handle, const Vector3& value)
+{
+    setVector(handleToIndex[handle], ANGULAR_VELOCITY_X, value);
+}
+
+Vector3 RigidBodyWorld::getAngularVelocity(RigidBodyHandle handle) const
+{
+    return getVector(handleToIndex[handle], ANGULAR_VELOCITY_X);
+}
+
+void RigidBodyWorld::setAcceleration(RigidBodyHandle handle, const Vector3& value)
+{
+    setVector(handleToIndex[handle], ACCELERATION_X, value);
+}
+
+void RigidBodyWorld::setDamping(RigidBodyHandle handle, float linearDamping, float angularDamping)
+{
+    unsigned index = handleToIndex[handle];
+    slot(index, LINEAR_DAMPING) = linearDamping;
+    slot(index, ANGULAR_DAMPING) = angularDamping;
+
+    bool haveStep = factorDeltaTime > 0.0f;
+    slot(index, LINEAR_DAMPING_FACTOR) = haveStep ? powf(linearDamping, factorDeltaTime) : 1.0f;
+    slot(index, ANGULAR_DAMPING_FACTOR) = haveStep ? powf(angularDamping, factorDeltaTime) : 1.0f;
+}
+
+void RigidBodyWorld::setInverseMass(RigidBodyHandle handle, float value)
+{
+    slot(handleToIndex[handle], INVERSE_MASS) = value;
+}
+
+void RigidBodyWorld::setInverseInertiaTensor(RigidBodyHandle handle, const Matrix3x3& value)
+{
+    unsigned index = handleToIndex[handle];
+    for (unsigned k = 0; k < 9; k++)
+    {
+        slot(index, INVERSE_INERTIA_TENSOR + k) = value.data[k];
+    }
+}
+
+void RigidBodyWorld::setAwake(RigidBodyHandle handle, bool awake)
+{
+    unsigned index = handleToIndex[handle];
+    if (awake)
+    {
+        slot(index, AWAKE) = 1.0f;
+
+        // Give it a little motion so it doesn't fall straight back asleep
+        slot(index, MOTION) = getSleepEpsilon() * 2.0f;
+    }
+    else
+    {
+        slot(index, AWAKE) = 0.0f;
+        setVector(index, VELOCITY_X, Vector3());
+        setVector(index, ANGULAR_VELOCITY_X, Vector3());
+    }
+}
+
+bool RigidBodyWorld::getAwake(RigidBodyHandle handle) const
+{
+    return slot(handleToIndex[handle], AWAKE) != 0.0f;
+}
+
+void RigidBodyWorld::setCanSleep(RigidBodyHandle handle, bool canSleep)
+{
+    slot(handleToIndex[handle], CAN_SLEEP) = canSleep ? 1.0f : 0.0f;
+
+    if (!canSleep && !getAwake(handle)) setAwake(handle);
+}
+
+bool RigidBodyWorld::getCanSleep(RigidBodyHandle handle) const
+{
+    return slot(handleToIndex[handle], CAN_SLEEP) != 0.0f;
+}
+
+float RigidBodyWorld::getMotion(RigidBodyHandle handle) const
+{
+    return slot(handleToIndex[handle], MOTION);
+}
+
+Matrix3x4 RigidBodyWorld::getTransform(RigidBodyHandle handle) const
+{
+    unsigned index = handleToIndex[handle];
+    Matrix3x4 transform;
+    for (unsigned k = 0; k < 12; k++)
+    {
+        transform.data[k] = slot(index, TRANSFORM + k);
+    }
+    return transform;
+}
+
+Matrix3x3 RigidBodyWorld::getInverseInertiaTensorWorld(RigidBodyHandle handle) const
+{
+    unsigned index = handleToIndex[handle];
+    Matrix3x3 tensor;
+    for (unsigned k = 0; k < 9; k++)
+    {
+        tensor.data[k] = slot(index, INVERSE_INERTIA_TENSOR_WORLD + k);
+    }
+    return tensor;
+}
+
+void RigidBodyWorld::addForce(RigidBodyHandle handle, const Vector3& force)
+{
+    unsigned index = handleToIndex[handle];
+    setVector(index, FORCE_X, getVector(index, FORCE_X) + force);
+    setAwake(handle);
+}
+
+void RigidBodyWorld::addTorque(RigidBodyHandle handle, const Vector3& torque)
+{
+    unsigned index = handleToIndex[handle];
+    setVector(index, TORQUE_X, getVector(index, TORQUE_X) + torque);
+    setAwake(handle);
+}
+
+void RigidBodyWorld::addForceAtPoint(RigidBodyHandle handle, const Vector3& force, const Vector3& point)
+{
+    unsigned index = handleToIndex[handle];
+    Vector3 pt = point - getVector(index, POSITION_X);
+
+    setVector(index, FORCE_X, getVector(index, FORCE_X) + force);
+    setVector(index, TORQUE_X, getVector(index, TORQUE_X) + Vector3::cross(pt, force));
+    setAwake(handle);
+}
+
+void RigidBodyWorld::integrate(float deltaTime)
+{
+    updateDampingFactors(deltaTime);
+
+    float sleepEpsilon = getSleepEpsilon();
+    unsigned count = getBodyCount();
+    unsigned i = 0;
+
+    // Unused lanes of the last block are zero, so asleep, and every block
+    // runs as whole vectors; blocks with nobody awake are skipped, and only
+// blocks with some asleep pay for masking
+#if defined(PHYSICS_SIMD_AVX)
+    for (; i < count; i += LANES)
+    {
+        unsigned awake = countAwake(block(i));
+        if (awake == LANES) integrateLanes<Float8, false>(block(i), deltaTime, motionBias, sleepEpsilon);
+        else if (awake > 0) integrateLanes<Float8, true>(block(i), deltaTime, motionBias, sleepEpsilon);
+    }
+#elif defined(PHYSICS_SIMD_SSE)
+    for (; i < count; i += LANES)
+    {
+        unsigned awake = countAwake(block(i));
+        if (awake == LANES)
+        {
+            integrateLanes<Float4, false>(block(i), deltaTime, motionBias, sleepEpsilon);
+            integrateLanes<Float4, false>(block(i) + 4, deltaTime, motionBias, sleepEpsilon);
+        }
+        else if (awake > 0)
+        {
+            integrateLanes<Float4, true>(block(i), deltaTime, motionBias, sleepEpsilon);
+            integrateLanes<Float4, true>(block(i) + 4, deltaTime, motionBias, sleepEpsilon);
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        if (slot(i, AWAKE) == 0.0f) continue;
+        integrateLanes<Float1, false>(block(i) + i % LANES, deltaTime, motionBias, sleepEpsilon);
+    }
+}
+
+void RigidBodyWorld::integrateScalar(float deltaTime)
+{
+    updateDampingFactors(deltaTime);
+
+    float sleepEpsilon = getSleepEpsilon();
+    unsigned count = getBodyCount();
+    for (unsigned i = 0; i < count; i++)
+    {
+        // Sleeping bodies don't move until something wakes them
+        if (slot(i, AWAKE) == 0.0f) continue;
+        integrateLanes<Float1, false>(block(i) + i % LANES, deltaTime, motionBias, sleepEpsilon);
+    }
+}
+
+void RigidBodyWorld::calculateDerivedData()
+{
+    unsigned count = getBodyCount();
+    unsigned i = 0;
+
+#if defined(PHYSICS_SIMD_AVX)
+    for (; i < count; i += LANES)
+    {
+        deriveLanes<Float8, false>(block(i), Float8::set(1.0f));
+    }
+#elif defined(PHYSICS_SIMD_SSE)
+    for (; i < count; i += LANES)
+    {
+        deriveLanes<Float4, false>(block(i), Float4::set(1.0f));
+        deriveLanes<Float4, false>(block(i) + 4, Float4::set(1.0f));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        deriveLanes<Float1, false>(block(i) + i % LANES, Float1::set(1.0f));
+    }
+}
+
+float RigidBodyWorld::getValue(RigidBodyHandle handle, Field field) const
+{
+    return slot(handleToIndex[handle], field);
+}
+
+void RigidBodyWorld::updateDampingFactors(float deltaTime)
+{
+    if (deltaTime == factorDeltaTime) return;
+
+    // Only recomputed when the time step changes
+    factorDeltaTime = deltaTime;
+    motionBias = powf(0.5f, deltaTime);
+    unsigned count = getBodyCount();
+    for (unsigned i = 0; i < count; i++)
+    {
+        slot(i, LINEAR_DAMPING_FACTOR) = powf(slot(i, LINEAR_DAMPING), deltaTime);
+        slot(i, ANGULAR_DAMPING_FACTOR) = powf(slot(i, ANGULAR_DAMPING), deltaTime);
+    }
+}
+
+float* RigidBodyWorld::block(unsigned index)
+{
+    return &blocks[index / LANES * BLOCK_SIZE];
+}
+
+float& RigidBodyWorld::slot(unsigned index, unsigned field)
+{
+    return blocks[index / LANES * BLOCK_SIZE + field * LANES + index % LANES];
+}
+
+float RigidBodyWorld::slot(unsigned index, unsigned field) const
+{
+    return blocks[index / LANES * BLOCK_SIZE + field * LANES + index % LANES];
+}
+
+Vector3 RigidBodyWorld::getVector(unsigned index, Field x) const
+{
+    return Vector3(slot(index, x), slot(index, x + 1), slot(index, x + 2));
+}
+
+void RigidBodyWorld::setVector(unsigned index, Field x, const Vector3& value)
+{
+    slot(index, x) = value.x;
+    slot(index, x + 1) = value.y;
+    slot(index, x + 2) = value.z;
+}
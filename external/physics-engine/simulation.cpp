@@ -0,0 +1,259 @@
+#include "include/simulation.hpp"
+#include "include/profiler.hpp"
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+
+Simulation::Simulation(float timeStep, unsigned initialContacts, unsigned maxStepsPerAdvance)
+    : timeStep(timeStep), accumulator(0.0f), maxStepsPerAdvance(maxStepsPerAdvance), stepCount(0), particleListVersion(0), contacts(NULL), contactCapacity(initialContacts),
+    usedContacts(0), contactHighWater(0), contactOverflowCount(0), resolver(0), activeResolver(&resolver) {}
+
+unsigned Simulation::addRigidBody(RigidBody* body)
+{
+    bodies.push_back(body);
+    previousPositions.push_back(body->getPosition());
+    previousOrientations.push_back(body->getOrientation());
+    return (unsigned)bodies.size() - 1;
+}
+
+unsigned Simulation::createRigidBody()
+{
+    return addRigidBody(rigidBodyPool.create());
+}
+
+RigidBody* Simulation::getRigidBody(unsigned body)
+{
+    return bodies[body];
+}
+
+void Simulation::addParticle(Particle* particle)
+{
+    particles.push_back(particle);
+    particleListVersion++;
+}
+
+Particle* Simulation::createParticle()
+{
+    Particle* particle = particlePool.create();
+    addParticle(particle);
+    return particle;
+}
+
+void Simulation::destroyParticle(Particle* particle)
+{
+    std::vector<Particle*>::iterator found = std::find(particles.begin(), particles.end(), particle);
+    assert(found != particles.end());
+
+    // Erased in place so the particles before it keep their indices
+    particles.erase(found);
+    particleListVersion++;
+    usedContacts = 0;
+    particlePool.destroy(particle);
+}
+
+void Simulation::addContactGenerator(ParticleContactGenerator* generator)
+{
+    contactGenerators.push_back(generator);
+}
+
+void Simulation::addForceGenerator(unsigned body, ForceGenerator* generator)
+{
+    ForceRegistration registration = { body, generator };
+    forceRegistrations.push_back(registration);
+}
+
+const std::vector<Particle*>& Simulation::getParticles() const
+{
+    return particles;
+}
+
+unsigned Simulation::advance(float elapsed)
+{
+    accumulator += elapsed;
+
+    unsigned steps = 0;
+    while (accumulator >= timeStep && steps < maxStepsPerAdvance)
+    {
+        step();
+        accumulator -= timeStep;
+        steps++;
+    }
+
+    // Drop time we could not catch up on rather than falling further behind
+    if (accumulator >= timeStep)
+    {
+        accumulator = fmodf(accumulator, timeStep);
+    }
+
+    return steps;
+}
+
+void Simulation::step()
+{
+    PROFILE_ZONE("step");
+
+    updateForces();
+    integrate();
+
+    arena.reset();
+    usedContacts = generateContacts();
+    if (usedContacts > contactHighWater) contactHighWater = usedContacts;
+    PROFILE_COUNTER("contacts", usedContacts);
+
+    if (usedContacts)
+    {
+        activeResolver->setIterations(usedContacts * 2);
+        activeResolver->resolveContacts(contacts, usedContacts, timeStep);
+    }
+
+    stepCount++;
+}
+
+void Simulation::updateForces()
+{
+    for (unsigned i = 0; i < forceRegistrations.size(); i++)
+    {
+        forceRegistrations[i].generator->updateForce(bodies[forceRegistrations[i].body], timeStep);
+    }
+}
+
+void Simulation::integrate()
+{
+    PROFILE_ZONE("integrate");
+
+    for (unsigned i = 0; i < bodies.size(); i++)
+    {
+        previousPositions[i] = bodies[i]->getPosition();
+        previousOrientations[i] = bodies[i]->getOrientation();
+        bodies[i]->integrate(timeStep);
+    }
+
+    for (unsigned i = 0; i < particles.size(); i++)
+    {
+        particles[i]->integrate(timeStep);
+    }
+}
+
+unsigned Simulation::generateContacts()
+{
+    PROFILE_ZONE("generateContacts");
+
+    contacts = arena.allocateArray<ParticleContact>(contactCapacity);
+    unsigned count = 0;
+
+    for (unsigned g = 0; g < contactGenerators.size(); g++)
+    {
+        bool truncated;
+        unsigned used = contactGenerators[g]->addContactChecked(contacts + count, contactCapacity - count, &truncated);
+
+        // The generator ran out of room, so grow the buffer and run it again
+        while (truncated)
+        {
+            growContacts(count);
+            used = contactGenerators[g]->addContactChecked(contacts + count, contactCapacity - count, &truncated);
+        }
+
+        count += used;
+    }
+
+    return count;
+}
+
+void Simulation::growContacts(unsigned count)
+{
+    unsigned capacity = contactCapacity < 8 ? 16 : contactCapacity * 2;
+    ParticleContact* grown = arena.allocateArray<ParticleContact>(capacity);
+    for (unsigned i = 0; i < count; i++)
+    {
+        grown[i] = contacts[i];
+    }
+
+    // Keep the larger size so later steps allocate it up front
+    contacts = grown;
+    contactCapacity = capacity;
+    contactOverflowCount++;
+}
+
+float Simulation::getTimeStep() const
+{
+    return timeStep;
+}
+
+unsigned Simulation::getStepCount() const
+{
+    return stepCount;
+}
+
+unsigned Simulation::getContactCount() const
+{
+    return usedContacts;
+}
+
+const ParticleContact* Simulation::getContacts() const
+{
+    return contacts;
+}
+
+unsigned Simulation::getContactCapacity() const
+{
+    return contactCapacity;
+}
+
+unsigned Simulation::getContactHighWater() const
+{
+    return contactHighWater;
+}
+
+unsigned Simulation::getContactOverflowCount() const
+{
+    return contactOverflowCount;
+}
+
+const FrameArena& Simulation::getArena() const
+{
+    return arena;
+}
+
+ParticleContactResolver& Simulation::getResolver()
+{
+    return resolver;
+}
+
+void Simulation::setResolver(ParticleContactResolverBase* contactResolver)
+{
+    activeResolver = contactResolver ? contactResolver : &resolver;
+}
+
+float Simulation::getInterpolationAlpha() const
+{
+    return accumulator / timeStep;
+}
+
+Vector3 Simulation::getInterpolatedPosition(unsigned body) const
+{
+    float alpha = getInterpolationAlpha();
+    Vector3 previous = previousPositions[body];
+    return previous + (bodies[body]->getPosition() - previous) * alpha;
+}
+
+Matrix3x4 Simulation::getInterpolatedTransform(unsigned body) const
+{
+    float alpha = getInterpolationAlpha();
+    Quaternion previous = previousOrientations[body];
+    Quaternion current = bodies[body]->getOrientation();
+
+    // Blend along the shorter arc
+    float dot = previous.x * current.x + previous.y * current.y + previous.z * current.z + previous.w * current.w;
+    float sign = dot < 0.0f ? -1.0f : 1.0f;
+
+    Quaternion orientation(
+        previous.x * sign * (1.0f - alpha) + current.x * alpha,
+        previous.y * sign * (1.0f - alpha) + current.y * alpha,
+        previous.z * sign * (1.0f - alpha) + current.z * alpha,
+        previous.w * sign * (1.0f - alpha) + current.w * alpha);
+    orientation.normalize();
+
+    Matrix3x4 transform;
+    transform.setOrientationAndPos(orientation, getInterpolatedPosition(body));
+    return transform;
+}
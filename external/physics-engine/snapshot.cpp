@@ -0,0 +1,535 @@
+#include "include/snapshot.hpp"
+#include "include/simd.hpp"
+#include <algorithm>
+#include <functional>
+#include <string.h>
+#include <type_traits>
+
+const uint32_t Snapshot::MAGIC = 0x4E534850; // "PHSN"
+const uint32_t Snapshot::VERSION = 2;
+
+// "PHDL"
+static const uint32_t DELTA_MAGIC = 0x4C444850;
+
+// Deltas XOR each word with the word it replaces. Every block of words starts
+// with a 16-bit flag, 0 when nothing in it changed; otherwise a 2-bit code per
+// word follows, four to a byte, giving how many 16-bit halves of the word are
+// stored: none, the low half or both. A float that changes a little keeps its
+// sign and exponent, so the high half of the XOR is often zero. Halves rather
+// than bytes keep the stores aligned, which is most of the encoding time; the
+// codes and store offsets for four words come from a table. Between snapshots
+// of the same bodies, the state each body had at the start of the last step is
+// XORed with that body's state in the base, which it almost always equals.
+static const size_t DELTA_BLOCK_WORDS = 256;
+
+// Codes for a block, padded to keep the halves after them aligned
+static size_t codeSize(size_t count)
+{
+    return (count + 7) / 8 * 2;
+}
+
+static void writeHalf(unsigned char* data, uint16_t value)
+{
+    memcpy(data, &value, 2);
+}
+
+static uint16_t readHalf(const unsigned char* data)
+{
+    uint16_t value;
+    memcpy(&value, data, 2);
+    return value;
+}
+
+static void writeWord(unsigned char* data, size_t word, uint32_t value)
+{
+    memcpy(data + word * 4, &value, 4);
+}
+
+// Particles and bodies are captured and restored as raw bytes
+static_assert(std::is_trivially_copyable<Particle>::value, "particles are copied with memcpy");
+static_assert(std::is_trivially_copyable<RigidBody>::value, "bodies are copied with memcpy");
+
+// Each body is stored after its state at the start of the last step, kept for
+// render interpolation, so a delta can predict that state from the base's body
+// next to it
+static const size_t PREDICTED_WORDS = (sizeof(Vector3) + sizeof(Quaternion)) / 4;
+static const size_t BODY_RECORD_SIZE = PREDICTED_WORDS * 4 + sizeof(RigidBody);
+static_assert(std::is_standard_layout<RigidBody>::value, "predictions read body fields by offset");
+
+// Codes and store offsets for a group of four words, indexed by a mask of the
+// words that changed with a mask of those whose high half changed above it
+struct GroupTable
+{
+    unsigned char code[256];
+
+    unsigned char offset[256][4];
+
+    unsigned char size[256];
+
+    GroupTable()
+    {
+        for (unsigned mask = 0; mask < 256; mask++)
+        {
+            code[mask] = 0;
+            size[mask] = 0;
+            for (unsigned j = 0; j < 4; j++)
+            {
+                unsigned changed = mask >> j & 1;
+                unsigned kept = changed + (changed & mask >> (j + 4));
+                code[mask] |= (unsigned char)(kept << (j * 2));
+                offset[mask][j] = size[mask];
+                size[mask] += (unsigned char)(kept * 2);
+            }
+        }
+    }
+};
+
+static const GroupTable groupTable;
+
+// Encodes count words, a multiple of four, XORed with the expected words,
+// writing a code byte per four words; returns the end of the halves
+static unsigned char* encodeGroups(const unsigned char* current, const unsigned char* expected, size_t count, unsigned char* codes, unsigned char* out)
+{
+#if defined(PHYSICS_SIMD_SSE)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi32((int)0x80000000u);
+    const __m128i halfLimit = _mm_set1_epi32((int)0x8000FFFFu);
+#endif
+
+    for (size_t k = 0; k < count; k += 4)
+    {
+        uint32_t x[4];
+#if defined(PHYSICS_SIMD_SSE)
+        __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(current + k * 4)), _mm_loadu_si128((const __m128i*)(expected + k * 4)));
+        _mm_storeu_si128((__m128i*)x, v);
+
+        // Unsigned compare through the sign bit
+        unsigned changed = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, zero))) & 15;
+        unsigned high = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(_mm_xor_si128(v, bias), halfLimit)));
+#else
+        uint32_t y[4];
+        memcpy(x, current + k * 4, sizeof(x));
+        memcpy(y, expected + k * 4, sizeof(y));
+
+        unsigned changed = 0;
+        unsigned high = 0;
+        for (unsigned j = 0; j < 4; j++)
+        {
+            x[j] ^= y[j];
+            changed |= (x[j] != 0) << j;
+            high |= (x[j] > 0xFFFF) << j;
+        }
+#endif
+
+        // Each word is stored whole; the next word overwrites any half that isn't kept
+        unsigned mask = changed | high << 4;
+        for (unsigned j = 0; j < 4; j++)
+        {
+            unsigned char* at = out + groupTable.offset[mask][j];
+            writeHalf(at, (uint16_t)x[j]);
+            writeHalf(at + 2, (uint16_t)(x[j] >> 16));
+        }
+        codes[k / 4] = groupTable.code[mask];
+        out += groupTable.size[mask];
+    }
+
+    return out;
+}
+
+struct DeltaHeader
+{
+    uint32_t magic;
+
+    uint32_t version;
+
+    uint32_t baseSize;
+
+    uint32_t size;
+
+    // Whether the state at the start of the last step is predicted from the base's bodies
+    uint32_t predicted;
+};
+
+Snapshot::Snapshot() : indexedSimulation(NULL), indexedVersion(0) {}
+
+bool Snapshot::ParticleIndex::operator<(const ParticleIndex& other) const
+{
+    return std::less<const Particle*>()(particle, other.particle);
+}
+
+size_t Snapshot::bodiesOffset(const Header& h)
+{
+    return sizeof(Header) + (size_t)h.particleCount * sizeof(Particle);
+}
+
+size_t Snapshot::expectedSize(const Header& h)
+{
+    return sizeof(Header) + (size_t)h.particleCount * sizeof(Particle) +
+        (size_t)h.bodyCount * BODY_RECORD_SIZE +
+        (size_t)h.contactCount * sizeof(ContactRecord);
+}
+
+void Snapshot::capture(const Simulation& simulation)
+{
+    Header h;
+    h.magic = MAGIC;
+    h.version = VERSION;
+    h.particleSize = sizeof(Particle);
+    h.bodySize = sizeof(RigidBody);
+    h.contactSize = sizeof(ContactRecord);
+    h.particleCount = (uint32_t)simulation.particles.size();
+    h.bodyCount = (uint32_t)simulation.bodies.size();
+    h.contactCount = simulation.usedContacts;
+    h.stepCount = simulation.stepCount;
+    h.timeStep = simulation.timeStep;
+    h.accumulator = simulation.accumulator;
+    h.sleepEpsilon = getSleepEpsilon();
+
+    data.resize(expectedSize(h));
+    unsigned char* out = &data[0];
+    memcpy(out, &h, sizeof(Header));
+    out += sizeof(Header);
+
+    for (unsigned i = 0; i < h.particleCount; i++)
+    {
+        memcpy(out, simulation.particles[i], sizeof(Particle));
+        out += sizeof(Particle);
+    }
+
+    for (unsigned i = 0; i < h.bodyCount; i++)
+    {
+        memcpy(out, &simulation.previousPositions[i], sizeof(Vector3));
+        out += sizeof(Vector3);
+        memcpy(out, &simulation.previousOrientations[i], sizeof(Quaternion));
+        out += sizeof(Quaternion);
+        memcpy(out, simulation.bodies[i], sizeof(RigidBody));
+        out += sizeof(RigidBody);
+    }
+
+    for (unsigned i = 0; i < h.contactCount; i++)
+    {
+        const ParticleContact& contact = simulation.contacts[i];
+
+        ContactRecord record;
+        record.particle[0] = findParticle(simulation, contact.particle[0]);
+        record.particle[1] = findParticle(simulation, contact.particle[1]);
+        record.restitution = contact.restitution;
+        record.contactNormal = contact.contactNormal;
+        record.penetration = contact.penetration;
+        record.particleMovement[0] = contact.particleMovement[0];
+        record.particleMovement[1] = contact.particleMovement[1];
+
+        memcpy(out, &record, sizeof(ContactRecord));
+        out += sizeof(ContactRecord);
+    }
+}
+
+bool Snapshot::restore(Simulation& simulation) const
+{
+    const Header* h = header();
+    if (!h) return false;
+
+    if (h->particleCount != simulation.particles.size() || h->bodyCount != simulation.bodies.size() || h->timeStep != simulation.timeStep)
+    {
+        return false;
+    }
+
+    const unsigned char* in = &data[0] + sizeof(Header);
+
+    for (unsigned i = 0; i < h->particleCount; i++)
+    {
+        memcpy(simulation.particles[i], in, sizeof(Particle));
+        in += sizeof(Particle);
+    }
+
+    for (unsigned i = 0; i < h->bodyCount; i++)
+    {
+        memcpy(&simulation.previousPositions[i], in, sizeof(Vector3));
+        in += sizeof(Vector3);
+        memcpy(&simulation.previousOrientations[i], in, sizeof(Quaternion));
+        in += sizeof(Quaternion);
+        memcpy(simulation.bodies[i], in, sizeof(RigidBody));
+        in += sizeof(RigidBody);
+    }
+
+    // Contacts go back into the frame arena, as if the restored step had generated them
+    if (h->contactCount > simulation.contactCapacity) simulation.contactCapacity = h->contactCount;
+    simulation.arena.reset();
+    simulation.contacts = simulation.arena.allocateArray<ParticleContact>(simulation.contactCapacity);
+
+    for (unsigned i = 0; i < h->contactCount; i++)
+    {
+        ContactRecord record;
+        memcpy(&record, in, sizeof(ContactRecord));
+        in += sizeof(ContactRecord);
+
+        ParticleContact& contact = simulation.contacts[i];
+        for (unsigned k = 0; k < 2; k++)
+        {
+            bool valid = record.particle[k] >= 0 && (uint32_t)record.particle[k] < h->particleCount;
+            contact.particle[k] = valid ? simulation.particles[record.particle[k]] : NULL;
+        }
+        contact.restitution = record.restitution;
+        contact.contactNormal = record.contactNormal;
+        contact.penetration = record.penetration;
+        contact.particleMovement[0] = record.particleMovement[0];
+        contact.particleMovement[1] = record.particleMovement[1];
+    }
+
+    simulation.usedContacts = h->contactCount;
+    simulation.stepCount = h->stepCount;
+    simulation.accumulator = h->accumulator;
+    setSleepEpsilon(h->sleepEpsilon);
+
+    return true;
+}
+
+const unsigned char* Snapshot::getData() const
+{
+    return data.empty() ? NULL : &data[0];
+}
+
+size_t Snapshot::getSize() const
+{
+    return data.size();
+}
+
+void Snapshot::swap(Snapshot& other)
+{
+    data.swap(other.data);
+    particleIndices.swap(other.particleIndices);
+    std::swap(indexedSimulation, other.indexedSimulation);
+    std::swap(indexedVersion, other.indexedVersion);
+}
+
+bool Snapshot::setData(const unsigned char* source, size_t size)
+{
+    data.assign(source, source + size);
+    if (header()) return true;
+
+    data.clear();
+    return false;
+}
+
+void Snapshot::encodeDelta(const Snapshot& previous, std::vector<unsigned char>& delta) const
+{
+    size_t words = data.size() / 4;
+    size_t baseWords = previous.data.size() / 4;
+
+    // Worst case for a block is every word changed in both halves, plus a word
+    // the last group may store past its end. The buffer grows a block at a
+    // time, so reusing it doesn't clear far ahead of the encoder
+    size_t blockBound = 2 + codeSize(DELTA_BLOCK_WORDS) + DELTA_BLOCK_WORDS * 4 + 4;
+    delta.resize(sizeof(DeltaHeader) + blockBound);
+    unsigned char* out = &delta[0];
+
+    // With the same bodies and particles, the state at the start of the last
+    // step is usually the state the base snapshot ended with
+    const Header* h = header();
+    const Header* baseHeader = previous.header();
+    bool predicted = h && baseHeader && h->particleCount == baseHeader->particleCount && h->bodyCount == baseHeader->bodyCount;
+    size_t bodiesFirst = predicted ? bodiesOffset(*h) / 4 : 0;
+    size_t bodiesEnd = predicted ? bodiesFirst + h->bodyCount * BODY_RECORD_SIZE / 4 : 0;
+
+    DeltaHeader dh = { DELTA_MAGIC, VERSION, (uint32_t)previous.data.size(), (uint32_t)data.size(), predicted ? 1u : 0u };
+    memcpy(out, &dh, sizeof(DeltaHeader));
+    out += sizeof(DeltaHeader);
+
+    // Whole blocks clear of the predicted bodies and of the end of the base
+    // are XORed with the base in place; the rest with a copy of it, predictions
+    // filled in, and the last block is padded to whole groups
+    const unsigned char* current = getData();
+    const unsigned char* base = previous.getData();
+    const Header* prediction = predicted ? baseHeader : NULL;
+    uint32_t block[DELTA_BLOCK_WORDS];
+    uint32_t expected[DELTA_BLOCK_WORDS];
+
+    for (size_t first = 0; first < words; first += DELTA_BLOCK_WORDS)
+    {
+        size_t used = out - &delta[0];
+        if (delta.size() < used + blockBound) delta.resize(used + blockBound);
+        out = &delta[0] + used;
+
+        size_t count = std::min(DELTA_BLOCK_WORDS, words - first);
+        const unsigned char* from = current + first * 4;
+        const unsigned char* against = base + first * 4;
+
+        bool plain = count == DELTA_BLOCK_WORDS && first + count <= baseWords && (first + count <= bodiesFirst || first >= bodiesEnd);
+        if (!plain)
+        {
+            expectedWords(base, baseWords, prediction, first, count, expected);
+            memset(expected + count, 0, (DELTA_BLOCK_WORDS - count) * 4);
+            against = (const unsigned char*)expected;
+        }
+        if (count < DELTA_BLOCK_WORDS)
+        {
+            memcpy(block, from, count * 4);
+            memset(block + count, 0, (DELTA_BLOCK_WORDS - count) * 4);
+            from = (const unsigned char*)block;
+        }
+
+        unsigned char* flag = out;
+        unsigned char* codes = out + 2;
+        unsigned char* halves = codes + codeSize(count);
+        codes[codeSize(count) - 1] = 0;
+        out = encodeGroups(from, against, (count + 3) / 4 * 4, codes, halves);
+
+        bool changed = out != halves;
+        writeHalf(flag, changed);
+        if (!changed) out = codes;
+    }
+
+    delta.resize(out - &delta[0]);
+}
+
+bool Snapshot::applyDelta(const unsigned char* delta, size_t size)
+{
+    DeltaHeader h;
+    if (size < sizeof(DeltaHeader)) return false;
+    memcpy(&h, delta, sizeof(DeltaHeader));
+    if (h.magic != DELTA_MAGIC || h.version != VERSION || h.baseSize != data.size() || h.size % 4 != 0 || h.predicted > 1) return false;
+
+    // Predictions read this snapshot's bodies, which must survive the resize;
+    // the header is copied since the resize may move it
+    Header baseHeader = {};
+    if (h.predicted)
+    {
+        if (!header()) return false;
+        baseHeader = *header();
+        if (bodiesOffset(baseHeader) + (size_t)baseHeader.bodyCount * BODY_RECORD_SIZE > h.size) return false;
+    }
+    size_t bodiesFirst = h.predicted ? bodiesOffset(baseHeader) / 4 : 0;
+    size_t bodiesEnd = h.predicted ? bodiesFirst + baseHeader.bodyCount * BODY_RECORD_SIZE / 4 : 0;
+
+    // Check the whole delta before touching the snapshot
+    size_t words = h.size / 4;
+    const unsigned char* end = delta + size;
+    const unsigned char* in = delta + sizeof(DeltaHeader);
+    for (size_t first = 0; first < words; first += DELTA_BLOCK_WORDS)
+    {
+        size_t count = std::min(DELTA_BLOCK_WORDS, words - first);
+        if (end - in < 2 || readHalf(in) > 1) return false;
+        bool changed = readHalf(in) != 0;
+        in += 2;
+        if (!changed) continue;
+
+        if ((size_t)(end - in) < codeSize(count)) return false;
+        size_t length = 0;
+        for (size_t k = 0; k < count; k++)
+        {
+            unsigned kept = (in[k / 4] >> (k % 4 * 2)) & 3;
+            if (kept > 2) return false;
+            length += kept * 2;
+        }
+        in += codeSize(count);
+        if ((size_t)(end - in) < length) return false;
+        in += length;
+    }
+    if (in != end) return false;
+
+    data.resize(h.size);
+    unsigned char* current = data.empty() ? NULL : &data[0];
+
+    // Predicted words come before the body they are predicted from, so
+    // working front to back reads each body before it is overwritten
+    const Header* prediction = h.predicted ? &baseHeader : NULL;
+    size_t baseWords = h.baseSize / 4;
+    uint32_t expected[DELTA_BLOCK_WORDS];
+
+    in = delta + sizeof(DeltaHeader);
+    for (size_t first = 0; first < words; first += DELTA_BLOCK_WORDS)
+    {
+        size_t count = std::min(DELTA_BLOCK_WORDS, words - first);
+        bool changed = readHalf(in) != 0;
+        in += 2;
+
+        // An unchanged block is only written where it was predicted
+        bool overlaps = first < bodiesEnd && first + count > bodiesFirst;
+        if (!changed && !overlaps) continue;
+
+        expectedWords(current, baseWords, prediction, first, count, expected);
+        if (!changed)
+        {
+            memcpy(current + first * 4, expected, count * 4);
+            continue;
+        }
+
+        const unsigned char* codes = in;
+        in += codeSize(count);
+        for (size_t k = 0; k < count; k++)
+        {
+            unsigned kept = (codes[k / 4] >> (k % 4 * 2)) & 3;
+            uint32_t x = 0;
+            if (kept > 0) x = readHalf(in);
+            if (kept > 1) x |= (uint32_t)readHalf(in + 2) << 16;
+            in += kept * 2;
+            writeWord(current, first + k, expected[k] ^ x);
+        }
+    }
+
+    return header() != NULL;
+}
+
+const Snapshot::Header* Snapshot::header() const
+{
+    if (data.size() < sizeof(Header)) return NULL;
+
+    const Header* h = reinterpret_cast<const Header*>(&data[0]);
+    if (h->magic != MAGIC || h->version != VERSION) return NULL;
+    if (h->particleSize != sizeof(Particle) || h->bodySize != sizeof(RigidBody) || h->contactSize != sizeof(ContactRecord)) return NULL;
+    if (data.size() != expectedSize(*h)) return NULL;
+
+    return h;
+}
+
+int32_t Snapshot::findParticle(const Simulation& simulation, const Particle* particle)
+{
+    if (!particle) return -1;
+
+    if (indexedSimulation != &simulation || indexedVersion != simulation.particleListVersion)
+    {
+        particleIndices.resize(simulation.particles.size());
+        for (unsigned i = 0; i < particleIndices.size(); i++)
+        {
+            particleIndices[i].particle = simulation.particles[i];
+            particleIndices[i].index = i;
+        }
+        std::sort(particleIndices.begin(), particleIndices.end());
+        indexedSimulation = &simulation;
+        indexedVersion = simulation.particleListVersion;
+    }
+
+    ParticleIndex key = { particle, 0 };
+    std::vector<ParticleIndex>::const_iterator found = std::lower_bound(particleIndices.begin(), particleIndices.end(), key);
+    if (found == particleIndices.end() || found->particle != particle) return -1;
+
+    return (int32_t)found->index;
+}
+
+void Snapshot::expectedWords(const unsigned char* base, size_t baseWords, const Header* predicted, size_t first, size_t count, uint32_t* out)
+{
+    size_t common = first < baseWords ? std::min(count, baseWords - first) : 0;
+    memcpy(out, base + first * 4, common * 4);
+    memset(out + common, 0, (count - common) * 4);
+    if (!predicted) return;
+
+    // A record's first words are predicted from the position and orientation
+    // of the body that follows them
+    size_t bodies = bodiesOffset(*predicted) / 4;
+    size_t recordWords = BODY_RECORD_SIZE / 4;
+    size_t end = first + count;
+    for (size_t body = first > bodies ? (first - bodies) / recordWords : 0; body < predicted->bodyCount; body++)
+    {
+        size_t record = bodies + body * recordWords;
+        if (record >= end) break;
+
+        uint32_t prediction[PREDICTED_WORDS];
+        const unsigned char* source = base + record * 4 + PREDICTED_WORDS * 4;
+        memcpy(prediction, source + offsetof(RigidBody, position), sizeof(Vector3));
+        memcpy(prediction + sizeof(Vector3) / 4, source + offsetof(RigidBody, orientation), sizeof(Quaternion));
+        for (size_t w = std::max(record, first); w < std::min(record + PREDICTED_WORDS, end); w++)
+        {
+            out[w - first] = prediction[w - record];
+        }
+    }
+}
@@ -0,0 +1,404 @@
+#include "include/snapshotrecorder.hpp"
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const uint32_t SnapshotRecorder::MAGIC = 0x43524850; // "PHRC"
+const uint32_t SnapshotRecorder::VERSION = 1;
+
+enum RecordType
+{
+    RECORD_FULL,
+    RECORD_DELTA
+};
+
+struct FileHeader
+{
+    uint32_t magic;
+
+    uint32_t version;
+
+    uint32_t keyframeInterval;
+
+    uint32_t reserved;
+};
+
+struct RecordHeader
+{
+    uint32_t type;
+
+    uint32_t size;
+};
+
+#ifdef _WIN32
+MappedFile::MappedFile() : data(NULL), capacity(0), writable(false), file(INVALID_HANDLE_VALUE), mapping(NULL) {}
+#else
+MappedFile::MappedFile() : data(NULL), capacity(0), writable(false), file(-1) {}
+#endif
+
+MappedFile::~MappedFile()
+{
+    close(capacity);
+}
+
+bool MappedFile::create(const char* path, size_t size)
+{
+    close(capacity);
+
+#ifdef _WIN32
+    file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+#else
+    file = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) return false;
+#endif
+
+    capacity = size;
+    if (map(true)) return true;
+
+    close(0);
+    return false;
+}
+
+bool MappedFile::openRead(const char* path)
+{
+    close(capacity);
+
+#ifdef _WIN32
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        close(0);
+        return false;
+    }
+    capacity = (size_t)fileSize.QuadPart;
+#else
+    file = ::open(path, O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat status;
+    if (fstat(file, &status) != 0)
+    {
+        close(0);
+        return false;
+    }
+    capacity = (size_t)status.st_size;
+#endif
+
+    if (map(false)) return true;
+
+    close(0);
+    return false;
+}
+
+bool MappedFile::grow(size_t size)
+{
+    if (!writable || size <= capacity) return writable;
+
+    unmap();
+    capacity = size;
+    return map(true);
+}
+
+void MappedFile::close(size_t size)
+{
+    bool trim = writable;
+    unmap();
+
+#ifdef _WIN32
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        if (trim)
+        {
+            LARGE_INTEGER end;
+            end.QuadPart = (LONGLONG)size;
+            SetFilePointerEx(file, end, NULL, FILE_BEGIN);
+            SetEndOfFile(file);
+        }
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (file >= 0)
+    {
+        if (trim)
+        {
+            // On failure the file keeps its mapped size and readers stop at the zeroed tail
+            int result = ftruncate(file, (off_t)size);
+            (void)result;
+        }
+        ::close(file);
+        file = -1;
+    }
+#endif
+
+    capacity = 0;
+    writable = false;
+}
+
+unsigned char* MappedFile::getData() const
+{
+    return data;
+}
+
+size_t MappedFile::getCapacity() const
+{
+    return capacity;
+}
+
+bool MappedFile::map(bool write)
+{
+    writable = write;
+
+    // Nothing to map in an empty file
+    if (capacity == 0) return !write;
+
+#ifdef _WIN32
+    mapping = CreateFileMappingA(file, NULL, write ? PAGE_READWRITE : PAGE_READONLY, (DWORD)((uint64_t)capacity >> 32), (DWORD)(capacity & 0xFFFFFFFF), NULL);
+    if (!mapping) return false;
+
+    data = (unsigned char*)MapViewOfFile(mapping, write ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, capacity);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        mapping = NULL;
+        return false;
+    }
+#else
+    if (write && ftruncate(file, (off_t)capacity) != 0) return false;
+
+    void* memory = mmap(NULL, capacity, write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file, 0);
+    if (memory == MAP_FAILED) return false;
+    data = (unsigned char*)memory;
+#endif
+
+    return true;
+}
+
+void MappedFile::unmap()
+{
+    if (!data) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(mapping);
+    mapping = NULL;
+#else
+    munmap(data, capacity);
+#endif
+
+    data = NULL;
+}
+
+SnapshotRecorder::SnapshotRecorder() : size(0), keyframeInterval(60), frameCount(0), hasPending(false), busy(false), failed(false), stopping(false) {}
+
+SnapshotRecorder::~SnapshotRecorder()
+{
+    close();
+}
+
+bool SnapshotRecorder::open(const char* path, unsigned interval, size_t initialCapacity)
+{
+    close();
+
+    if (initialCapacity < sizeof(FileHeader)) initialCapacity = sizeof(FileHeader);
+    if (!file.create(path, initialCapacity)) return false;
+
+    keyframeInterval = interval > 0 ? interval : 1;
+    frameCount = 0;
+
+    FileHeader header = { MAGIC, VERSION, keyframeInterval, 0 };
+    memcpy(file.getData(), &header, sizeof(FileHeader));
+    size = sizeof(FileHeader);
+
+    hasPending = false;
+    busy = false;
+    failed = false;
+    stopping = false;
+    writer = std::thread(&SnapshotRecorder::writerLoop, this);
+
+    return true;
+}
+
+bool SnapshotRecorder::record(const Simulation& simulation)
+{
+    if (!writer.joinable()) return false;
+
+    // The capture is the only part on the caller's thread
+    captured.capture(simulation);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return !hasPending; });
+    if (failed) return false;
+
+    pending.swap(captured);
+    hasPending = true;
+    changed.notify_all();
+    return true;
+}
+
+bool SnapshotRecorder::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return !hasPending && !busy; });
+    return !failed;
+}
+
+const Snapshot& SnapshotRecorder::getLastFrame()
+{
+    flush();
+    return previous;
+}
+
+void SnapshotRecorder::close()
+{
+    if (writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        writer.join();
+    }
+
+    file.close(size);
+    size = 0;
+}
+
+unsigned SnapshotRecorder::getFrameCount()
+{
+    flush();
+    return frameCount;
+}
+
+size_t SnapshotRecorder::getSize()
+{
+    flush();
+    return size;
+}
+
+void SnapshotRecorder::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        // Queued frames are still written when closing
+        changed.wait(lock, [this] { return hasPending || stopping; });
+        if (!hasPending) return;
+
+        writing.swap(pending);
+        hasPending = false;
+        busy = true;
+        changed.notify_all();
+
+        lock.unlock();
+        bool written = !failed && write();
+        lock.lock();
+
+        if (!written) failed = true;
+        busy = false;
+        changed.notify_all();
+    }
+}
+
+bool SnapshotRecorder::write()
+{
+    bool keyframe = frameCount % keyframeInterval == 0;
+    if (!keyframe)
+    {
+        writing.encodeDelta(previous, delta);
+
+        // Everything changed; the full snapshot is no bigger
+        keyframe = delta.size() >= writing.getSize();
+    }
+
+    bool written = keyframe ? append(RECORD_FULL, writing.getData(), writing.getSize()) : append(RECORD_DELTA, &delta[0], delta.size());
+    if (!written) return false;
+
+    previous.swap(writing);
+    frameCount++;
+    return true;
+}
+
+bool SnapshotRecorder::append(uint32_t type, const unsigned char* payload, size_t payloadSize)
+{
+    size_t needed = size + sizeof(RecordHeader) + payloadSize;
+    if (needed > file.getCapacity())
+    {
+        // Double so a long session remaps only a handful of times
+        size_t capacity = file.getCapacity() * 2;
+        if (capacity < needed) capacity = needed;
+        if (!file.grow(capacity)) return false;
+    }
+
+    RecordHeader header = { type, (uint32_t)payloadSize };
+    memcpy(file.getData() + size, &header, sizeof(RecordHeader));
+    if (payloadSize) memcpy(file.getData() + size + sizeof(RecordHeader), payload, payloadSize);
+    size = needed;
+
+    return true;
+}
+
+SnapshotReader::SnapshotReader() : size(0), offset(0) {}
+
+bool SnapshotReader::open(const char* path)
+{
+    close();
+    if (!file.openRead(path)) return false;
+
+    FileHeader header;
+    size = file.getCapacity();
+    if (size < sizeof(FileHeader))
+    {
+        close();
+        return false;
+    }
+
+    memcpy(&header, file.getData(), sizeof(FileHeader));
+    if (header.magic != SnapshotRecorder::MAGIC || header.version != SnapshotRecorder::VERSION)
+    {
+        close();
+        return false;
+    }
+
+    offset = sizeof(FileHeader);
+    return true;
+}
+
+void SnapshotReader::close()
+{
+    file.close(0);
+    size = 0;
+    offset = 0;
+}
+
+bool SnapshotReader::next(Snapshot& snapshot)
+{
+    if (size - offset < sizeof(RecordHeader)) return false;
+
+    RecordHeader header;
+    memcpy(&header, file.getData() + offset, sizeof(RecordHeader));
+    const unsigned char* payload = file.getData() + offset + sizeof(RecordHeader);
+    if (size - offset - sizeof(RecordHeader) < header.size) return false;
+
+    bool valid = false;
+    if (header.type == RECORD_FULL) valid = current.setData(payload, header.size);
+    else if (header.type == RECORD_DELTA) valid = current.applyDelta(payload, header.size);
+    if (!valid) return false;
+
+    offset += sizeof(RecordHeader) + header.size;
+    snapshot = current;
+    return true;
+}
@@ -0,0 +1,96 @@
+#include "include/sweepprunecontact.hpp"
+#include <algorithm>
+
+void SweepPruneContact::init(const std::vector<Particle*>& particles, float radius, float restitution)
+{
+    ParticleCollision::init(particles, radius, restitution);
+    resetAxis();
+}
+
+unsigned SweepPruneContact::addContactChecked(ParticleContact* contact, unsigned limit, bool* truncated) const
+{
+    unsigned count = 0;
+    *truncated = false;
+    if (!particles) return count;
+
+    sortAxis();
+    const std::vector<Particle*>& list = *particles;
+
+    // Once the buffer is full, pairs are tested here to see whether any were left out
+    ParticleContact spare;
+
+    float contactDistance = radius * 2.0f;
+    unsigned numParticles = (unsigned)order.size();
+
+    for (unsigned i = 0; i < numParticles; i++)
+    {
+        // Later particles can only overlap while they are within a diameter on x
+        for (unsigned j = i + 1; j < numParticles && keys[j] - keys[i] < contactDistance; j++)
+        {
+            if (addPairContact(count < limit ? contact : &spare, list[order[i]], list[order[j]]))
+            {
+                if (count == limit)
+                {
+                    *truncated = true;
+                    return count;
+                }
+
+                contact++;
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+void SweepPruneContact::resetAxis() const
+{
+    // Full sort; later calls only repair the order
+    const std::vector<Particle*>& list = *particles;
+    unsigned numParticles = (unsigned)list.size();
+    order.resize(numParticles);
+    keys.resize(numParticles);
+    for (unsigned i = 0; i < numParticles; i++)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&list](unsigned a, unsigned b) {
+        float xa = list[a]->getPosition().x;
+        float xb = list[b]->getPosition().x;
+        return xa < xb || (xa == xb && a < b);
+    });
+}
+
+void SweepPruneContact::sortAxis() const
+{
+    // Particles were added or removed, so the order no longer covers them.
+    // When one was removed and another added the indices are all still in
+    // range, and the repair below moves them to where they now belong
+    if (order.size() != particles->size()) resetAxis();
+
+    const std::vector<Particle*>& list = *particles;
+    unsigned numParticles = (unsigned)order.size();
+    for (unsigned i = 0; i < numParticles; i++)
+    {
+        keys[i] = list[order[i]]->getPosition().x;
+    }
+
+    // Insertion sort, cheap when last frame's order is nearly right. Equal keys
+    // go by index, so the order depends only on the positions and a restored
+    // snapshot generates the same contacts whatever order was left from before
+    for (unsigned i = 1; i < numParticles; i++)
+    {
+        float key = keys[i];
+        unsigned index = order[i];
+        unsigned j = i;
+        while (j > 0 && (keys[j - 1] > key || (keys[j - 1] == key && order[j - 1] > index)))
+        {
+            keys[j] = keys[j - 1];
+            order[j] = order[j - 1];
+            j--;
+        }
+        keys[j] = key;
+        order[j] = index;
+    }
+}
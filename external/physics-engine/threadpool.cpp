@@ -0,0 +1,136 @@
+#include "include/threadpool.hpp"
+
+ThreadPool::ThreadPool(unsigned threadCount) : job(NULL), remaining(0), generation(0), stopping(false)
+{
+    if (threadCount == 0) threadCount = 1;
+
+    // Queue 0 belongs to the thread calling parallelFor
+    for (unsigned i = 0; i < threadCount; i++)
+    {
+        queues.push_back(new Queue());
+    }
+
+    for (unsigned i = 1; i < threadCount; i++)
+    {
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (unsigned i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+
+    for (unsigned i = 0; i < queues.size(); i++)
+    {
+        delete queues[i];
+    }
+}
+
+unsigned ThreadPool::getThreadCount() const
+{
+    return (unsigned)queues.size();
+}
+
+void ThreadPool::parallelFor(unsigned count, unsigned grainSize, const RangeTask& task)
+{
+    if (count == 0) return;
+    if (grainSize == 0) grainSize = 1;
+
+    // Not worth waking anyone up
+    if (workers.empty() || count <= grainSize)
+    {
+        task(0, count);
+        return;
+    }
+
+    job = &task;
+
+    // Deal chunks round-robin so every worker starts with local work
+    unsigned chunks = (count + grainSize - 1) / grainSize;
+    remaining.store(chunks);
+    for (unsigned c = 0; c < chunks; c++)
+    {
+        Range range;
+        range.begin = c * grainSize;
+        range.end = range.begin + grainSize < count ? range.begin + grainSize : count;
+
+        Queue* queue = queues[c % queues.size()];
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->ranges.push_back(range);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        generation++;
+    }
+    wake.notify_all();
+
+    while (remaining.load() > 0)
+    {
+        if (!runOne(0)) std::this_thread::yield();
+    }
+}
+
+void ThreadPool::workerLoop(unsigned index)
+{
+    unsigned seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        while (remaining.load() > 0)
+        {
+            if (!runOne(index)) std::this_thread::yield();
+        }
+    }
+}
+
+bool ThreadPool::runOne(unsigned index)
+{
+    Range range;
+    bool found = false;
+
+    // Newest local work first, then the oldest work of the other queues
+    {
+        Queue* own = queues[index];
+        std::lock_guard<std::mutex> lock(own->mutex);
+        if (!own->ranges.empty())
+        {
+            range = own->ranges.back();
+            own->ranges.pop_back();
+            found = true;
+        }
+    }
+
+    for (unsigned i = 1; !found && i < queues.size(); i++)
+    {
+        Queue* victim = queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim->mutex);
+        if (!victim->ranges.empty())
+        {
+            range = victim->ranges.front();
+            victim->ranges.pop_front();
+            found = true;
+        }
+    }
+
+    if (!found) return false;
+
+    (*job)(range.begin, range.end);
+    remaining.fetch_sub(1);
+    return true;
+}
@@ -0,0 +1,97 @@
+#include "include/uniformgridcontact.hpp"
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+// Outermost cell index; leaves room for the neighbour offsets without overflow
+static const float CELL_LIMIT = 1073741824.0f;
+
+// Converting an out-of-range float to int is undefined, so far-away and
+// non-finite coordinates are clamped into the outermost cells
+static int cellCoordinate(float value)
+{
+    float cell = floorf(value);
+    if (cell >= CELL_LIMIT) return (int)CELL_LIMIT;
+    if (!(cell > -CELL_LIMIT)) return -(int)CELL_LIMIT;
+    return (int)cell;
+}
+
+unsigned UniformGridContact::addContactChecked(ParticleContact* contact, unsigned limit, bool* truncated) const
+{
+    unsigned count = 0;
+    *truncated = false;
+
+    // Particles without size never touch, and would make the cells infinitely small
+    if (!particles || !(radius > 0.0f)) return count;
+    const std::vector<Particle*>& list = *particles;
+
+    // Once the buffer is full, pairs are tested here to see whether any were left out
+    ParticleContact spare;
+
+    // Cells are one diameter wide so overlapping particles are at most one cell apart
+    float inverseCellSize = 1.0f / (radius * 2.0f);
+    unsigned numParticles = (unsigned)list.size();
+
+    cells.resize(numParticles);
+    for (unsigned i = 0; i < numParticles; i++)
+    {
+        Vector3 position = list[i]->getPosition();
+        cells[i].x = cellCoordinate(position.x * inverseCellSize);
+        cells[i].y = cellCoordinate(position.y * inverseCellSize);
+        cells[i].z = cellCoordinate(position.z * inverseCellSize);
+        cells[i].particle = i;
+    }
+    std::sort(cells.begin(), cells.end());
+
+    unsigned begin = 0;
+    while (begin < numParticles)
+    {
+        // Find the run of particles sharing this cell
+        const Cell& cell = cells[begin];
+        unsigned end = begin + 1;
+        while (end < numParticles && cells[end].x == cell.x && cells[end].y == cell.y && cells[end].z == cell.z) end++;
+
+        // Neighbouring cells with the same x and y are contiguous along z
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                Cell low = { cell.x + dx, cell.y + dy, cell.z - 1, 0 };
+                Cell high = { cell.x + dx, cell.y + dy, cell.z + 1, std::numeric_limits<unsigned>::max() };
+                unsigned first = (unsigned)(std::lower_bound(cells.begin(), cells.end(), low) - cells.begin());
+                unsigned last = (unsigned)(std::upper_bound(cells.begin(), cells.end(), high) - cells.begin());
+
+                for (unsigned i = begin; i < end; i++)
+                {
+                    // Each pair is reported from the particle that sorts first
+                    for (unsigned k = std::max(first, i + 1); k < last; k++)
+                    {
+                        if (addPairContact(count < limit ? contact : &spare, list[cells[i].particle], list[cells[k].particle]))
+                        {
+                            if (count == limit)
+                            {
+                                *truncated = true;
+                                return count;
+                            }
+
+                            contact++;
+                            count++;
+                        }
+                    }
+                }
+            }
+        }
+
+        begin = end;
+    }
+
+    return count;
+}
+
+bool UniformGridContact::Cell::operator<(const Cell& other) const
+{
+    if (x != other.x) return x < other.x;
+    if (y != other.y) return y < other.y;
+    if (z != other.z) return z < other.z;
+    return particle < other.particle;
+}
@@ -1,11 +1,10 @@
 #include "Game.hpp"
-#include <particle.hpp>
-#include <groundcontact.hpp>
 
 const float Game::WINDOW_WIDTH = 1024.0f;
 const float Game::WINDOW_HEIGHT = 728.0f;
+const float Game::TIME_STEP = 1.0f / 60.0f;
 
-Game::Game() : mWindow(nullptr), mRenderer(nullptr), mTicksCount(0), mIsRunning(true), maxContacts(10) {}
+Game::Game() : mWindow(nullptr), mRenderer(nullptr), mTicksCount(0), mIsRunning(true), mSimulation(TIME_STEP, 10), mCharacter(nullptr) {}
 
 bool Game::Initialize()
 {
@@ -37,36 +36,20 @@ bool Game::Initialize()
 		return false;
 	}
 
-	resolver = new ParticleContactResolver(5);
+	mScene.Initialize(mSimulation, WINDOW_WIDTH, WINDOW_HEIGHT);
+	mCharacter = mScene.GetCharacter();
 
-	mCharacter = new RigidBody();
-
-	float x = WINDOW_WIDTH / 2.0f;
-	float y = WINDOW_HEIGHT / 2.0f;
-	float z = 0.0f;
-
-	mCharacter->setPosition(x, y, z);
-	mCharacter->setOrientation(0.0f, 0.0f, 0.0f, 1.0f);
-	mCharacter->setMass(1.0);
-	mCharacter->setAcceleration(Vector3::GRAVITY);
-	mCharacter->setLinearDamping(0.99);
-	mCharacter->setAngularDamping(0.99);
-	mCharacter->setInertiaTensor(Matrix3x3(0.3f * 500.0f, 0, 0, 0, 0.3f * 500.0f, 0, 0, 0, 0.3f * 500.0f));
-
-	mCharacter->clearAccumulators();
-	mCharacter->calculateDerivedData();
-
-	GroundContact* groundContactGenerator = new GroundContact();
-	groundContactGenerator->init(particles);
-	contactGenerators.push_back(groundContactGenerator);
-
-	contacts = new ParticleContact[maxContacts];
+	mTicksCount = SDL_GetTicks();
 
 	return true;
 }
 
 void Game::Shutdown()
 {
+#ifdef PHYSICS_PROFILER
+	Profiler::get().printSummary(stdout);
+#endif
+
 	SDL_DestroyRenderer(mRenderer);
 	SDL_DestroyWindow(mWindow);
 	SDL_Quit();
@@ -76,14 +59,31 @@ void Game::RunLoop()
 {
 	while (mIsRunning)
 	{
-		ProcessInput();
-		UpdateGame();
-		GenerateOutput();
+		// Sleep off the rest of the 16ms frame instead of spinning on the clock,
+		// outside the Frame zone so it times the work alone
+		Uint32 elapsed = SDL_GetTicks() - mTicksCount;
+		if (elapsed < 16)
+		{
+			SDL_Delay(16 - elapsed);
+		}
+
+		{
+			PROFILE_ZONE("Frame");
+
+			ProcessInput();
+			UpdateGame();
+			GenerateOutput();
+		}
+
+		// Collect this frame's zones and counters
+		PROFILE_FRAME();
 	}
 }
 
 void Game::ProcessInput()
 {
+	PROFILE_ZONE("ProcessInput");
+
 	SDL_Event event;
 
 	// Calling this function removes an event from the queue and stores it in the pointer
@@ -107,37 +107,13 @@ void Game::ProcessInput()
 		mIsRunning = false;
 	}
 
-	if (state[SDL_SCANCODE_SPACE])
-	{
-		Vector3 currentPosition = mCharacter->getPosition();
-		Vector3 point = Vector3(currentPosition.x - 50.0f, currentPosition.y - 50.0f, 0.0f);
-		mCharacter->addForceAtPoint(Vector3::UP * 250.0f, point);
-	}
-}
-
-unsigned Game::generateContacts()
-{
-	unsigned limit = maxContacts;
-	ParticleContact* nextContact = contacts;
-
-	for (std::vector<ParticleContactGenerator*>::iterator g = contactGenerators.begin(); g != contactGenerators.end(); g++)
-	{
-		unsigned used = (*g)->addContact(nextContact, limit);
-		limit -= used;
-		nextContact += used;
-
-		// Maximum number of collisions reached
-		if (limit <= 0) break;
-	}
-
-	// Return the current number of collisions
-	return maxContacts - limit;
+	// The thruster applies its force on every simulation step while space is held
+	mScene.GetThruster().SetFiring(state[SDL_SCANCODE_SPACE] != 0);
 }
 
 void Game::UpdateGame()
 {
-	// Wait until 16ms has elapsed since last frame
-	while (!SDL_TICKS_PASSED(SDL_GetTicks(), mTicksCount + 16));
+	PROFILE_ZONE("UpdateGame");
 
 	// Delta time is the difference in ticks from last frame
 	// (converted to seconds)
@@ -152,19 +128,14 @@ void Game::UpdateGame()
 		deltaTime = 0.05f;
 	}
 
-	mCharacter->integrate(deltaTime);
-
-	unsigned usedContacts = generateContacts();
-
-	if (usedContacts)
-	{
-		resolver->setIterations(usedContacts * 2);
-		resolver->resolveContacts(contacts, usedContacts, deltaTime);
-	}
+	// Physics runs in fixed steps; leftover time is interpolated when drawing
+	mSimulation.advance(deltaTime);
 }
 
 void Game::GenerateOutput()
 {
+	PROFILE_ZONE("GenerateOutput");
+
 	// Set color
 	SDL_SetRenderDrawColor(mRenderer, 0, 0, 255, 255);
 
@@ -174,8 +145,9 @@ void Game::GenerateOutput()
 	// Set the character's color
 	SDL_SetRenderDrawColor(mRenderer, 255, 255, 255, 255);
 
-	// Draw the character
-	Vector3 currentPosition = mCharacter->getPosition();
+	// Draw the character between its last two physics states
+	Matrix3x4 transform = mSimulation.getInterpolatedTransform(mScene.GetCharacterIndex());
+	Vector3 currentPosition = Vector3(transform.data[3], transform.data[7], transform.data[11]);
 
 	SDL_Rect character = {
 		static_cast<int>(WINDOW_WIDTH - (currentPosition.x + 50)),
@@ -187,7 +159,7 @@ void Game::GenerateOutput()
 
 	SDL_SetRenderDrawColor(mRenderer, 255, 0, 0, 255);
 
-	Vector3 pointWS = mCharacter->getPointInWorldSpace(Vector3(0.0f, 50.0f, 0.0f));
+	Vector3 pointWS = transform.transform(Vector3(0.0f, 50.0f, 0.0f));
 	SDL_RenderDrawLine(mRenderer, WINDOW_WIDTH - currentPosition.x, WINDOW_HEIGHT - currentPosition.y, WINDOW_WIDTH - pointWS.x, WINDOW_HEIGHT - pointWS.y);
 
 	// Swap the front and back buffers
@@ -3,19 +3,19 @@
 #ifndef GAME_HPP // include guard
 #define GAME_HPP
 
-#include <vector>
 #include <SDL.h>
 
-#include <particle.hpp>
-#include <rigidbody.hpp>
-#include <pcontactresolver.hpp>
-#include <pcontactgenerator.hpp>
+#include <profiler.hpp>
+#include <simulation.hpp>
+
+#include "Scene.hpp"
 
 class Game
 {
 public:
 	const static float WINDOW_WIDTH;
 	const static float WINDOW_HEIGHT;
+	const static float TIME_STEP;
 
 	Game();
 
@@ -35,8 +35,6 @@ private:
 
 	void GenerateOutput();
 
-	unsigned generateContacts();
-
 	SDL_Window* mWindow;
 
 	SDL_Renderer* mRenderer;
@@ -45,17 +43,11 @@ private:
 
 	bool mIsRunning;
 
-	std::vector<Particle*> particles;
-
-	RigidBody* mCharacter;
+	Simulation mSimulation;
 
-	ParticleContactResolver* resolver;
+	Scene mScene;
 
-	std::vector<ParticleContactGenerator*> contactGenerators;
-
-	ParticleContact* contacts;
-
-	unsigned maxContacts;
+	RigidBody* mCharacter;
 };
 
 #endif
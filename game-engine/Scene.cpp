@@ -0,0 +1,60 @@
+#include "Scene.hpp"
+
+Thruster::Thruster() : mFiring(false) {}
+
+void Thruster::SetFiring(bool firing)
+{
+	mFiring = firing;
+}
+
+void Thruster::updateForce(RigidBody* body, float)
+{
+	if (!mFiring) return;
+
+	Vector3 currentPosition = body->getPosition();
+	Vector3 point = Vector3(currentPosition.x - 50.0f, currentPosition.y - 50.0f, 0.0f);
+	body->addForceAtPoint(Vector3::UP * 250.0f, point);
+}
+
+Scene::Scene() : mCharacter(nullptr), mCharacterIndex(0) {}
+
+void Scene::Initialize(Simulation& simulation, float width, float height)
+{
+	float x = width / 2.0f;
+	float y = height / 2.0f;
+	float z = 0.0f;
+
+	mCharacterIndex = simulation.createRigidBody();
+	mCharacter = simulation.getRigidBody(mCharacterIndex);
+
+	mCharacter->setPosition(x, y, z);
+	mCharacter->setOrientation(0.0f, 0.0f, 0.0f, 1.0f);
+	mCharacter->setMass(1.0);
+	mCharacter->setAcceleration(Vector3::GRAVITY);
+	mCharacter->setLinearDamping(0.99);
+	mCharacter->setAngularDamping(0.99);
+	mCharacter->setInertiaTensor(Matrix3x3(0.3f * 500.0f, 0, 0, 0, 0.3f * 500.0f, 0, 0, 0, 0.3f * 500.0f));
+
+	mCharacter->clearAccumulators();
+	mCharacter->calculateDerivedData();
+
+	simulation.addForceGenerator(mCharacterIndex, &mThruster);
+
+	mGroundContact.init(simulation.getParticles());
+	simulation.addContactGenerator(&mGroundContact);
+}
+
+RigidBody* Scene::GetCharacter()
+{
+	return mCharacter;
+}
+
+unsigned Scene::GetCharacterIndex() const
+{
+	return mCharacterIndex;
+}
+
+Thruster& Scene::GetThruster()
+{
+	return mThruster;
+}
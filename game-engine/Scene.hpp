@@ -0,0 +1,53 @@
+#pragma once
+
+#ifndef SCENE_HPP // include guard
+#define SCENE_HPP
+
+#include <rigidbody.hpp>
+#include <forcegenerator.hpp>
+#include <groundcontact.hpp>
+#include <simulation.hpp>
+
+// Pushes the character up from a point below and to its left while firing.
+// Runs once per simulation step, so the push does not depend on the frame rate.
+class Thruster : public ForceGenerator
+{
+public:
+	Thruster();
+
+	void SetFiring(bool firing);
+
+	virtual void updateForce(RigidBody* body, float duration);
+
+private:
+	bool mFiring;
+};
+
+// The bodies and contact generators of the demo scene. Has no SDL dependency
+// so the windowed game and the headless runner simulate the same world. The
+// simulation owns the bodies; the scene owns its contact generators.
+class Scene
+{
+public:
+	Scene();
+
+	// Create the scene's objects and register them with the simulation
+	void Initialize(Simulation& simulation, float width, float height);
+
+	RigidBody* GetCharacter();
+
+	unsigned GetCharacterIndex() const;
+
+	Thruster& GetThruster();
+
+private:
+	RigidBody* mCharacter;
+
+	unsigned mCharacterIndex;
+
+	GroundContact mGroundContact;
+
+	Thruster mThruster;
+};
+
+#endif
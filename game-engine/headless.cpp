@@ -0,0 +1,76 @@
+// headless.cpp : Runs the game's physics without a window, as fast as the
+// CPU allows. Each step counts as a profiler frame; the per-stage summary is
+// printed at the end and a Chrome trace written when a path is given. With
+// more than one thread, contacts go through the parallel resolver.
+// Usage: Headless [steps] [runs] [trace.json] [threads]
+//
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <pcontactparallelresolver.hpp>
+#include <profiler.hpp>
+#include <simulation.hpp>
+
+#include "Scene.hpp"
+
+// Same world and time step as the windowed game
+static const float WORLD_WIDTH = 1024.0f;
+static const float WORLD_HEIGHT = 728.0f;
+static const float TIME_STEP = 1.0f / 60.0f;
+
+int main(int argc, char* argv[])
+{
+	unsigned steps = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : 3600;
+	unsigned runs = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 10) : 1;
+	unsigned threads = argc > 4 ? (unsigned)strtoul(argv[4], NULL, 10) : 1;
+
+	ParticleContactParallelResolver parallelResolver(0, threads > 1 ? threads : 1);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (unsigned run = 0; run < runs; run++)
+	{
+		Simulation simulation(TIME_STEP, 10);
+		if (threads > 1) simulation.setResolver(&parallelResolver);
+
+		Scene scene;
+		scene.Initialize(simulation, WORLD_WIDTH, WORLD_HEIGHT);
+
+		for (unsigned step = 0; step < steps; step++)
+		{
+			simulation.step();
+			PROFILE_FRAME();
+		}
+
+		Vector3 position = scene.GetCharacter()->getPosition();
+		printf("run %u: %u steps, character at (%f, %f, %f)\n", run, simulation.getStepCount(), position.x, position.y, position.z);
+		printf("run %u: contacts high water %u, contact overflows %u, arena high water %zu bytes, arena overflows %u\n", run,
+			simulation.getContactHighWater(), simulation.getContactOverflowCount(), simulation.getArena().getHighWater(), simulation.getArena().getOverflowCount());
+	}
+
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(end - start).count();
+	double simulated = (double)steps * runs * TIME_STEP;
+
+	printf("%u steps in %.3f s (%.0f steps/s, %.0fx real time)\n", steps * runs, seconds,
+		seconds > 0.0 ? steps * runs / seconds : 0.0, seconds > 0.0 ? simulated / seconds : 0.0);
+
+#ifdef PHYSICS_PROFILER
+	Profiler::get().printSummary(stdout);
+	printf("%lu profiler events dropped\n", Profiler::get().getDroppedCount());
+
+	if (argc > 3 && argv[3][0])
+	{
+		if (!Profiler::get().writeChromeTrace(argv[3]))
+		{
+			printf("Failed to write %s\n", argv[3]);
+			return 1;
+		}
+		printf("Trace written to %s\n", argv[3]);
+	}
+#endif
+
+	return 0;
+}